@@ -0,0 +1,150 @@
+/*
+ * File: ahead.c
+ * Description: Implementation of ahead.h
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "Ahead.h"
+#include "Cache.h"
+#include "Parser.h"
+#include "Arena.h"
+#include "error.h"
+
+// A line read and parsed by the helper
+typedef struct {
+  char *line;  // 0 marks the end of input
+  Flat flat;
+  char *error;
+} Item;
+
+// Representation of parse-ahead
+// The helper and the caller share a ring buffer of n items
+typedef struct {
+  AheadReadF read;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t notempty;
+  pthread_cond_t notfull;
+  Item *items;
+  int n;
+  int head;   // next item for the caller
+  int count;  // items waiting
+  int stop;   // 1 once the caller is done
+  Parser parser; // the helper's own parse state
+  Arena arena;
+} *AheadRep;
+
+// This function is the helper thread: read, parse, queue, repeat
+// Parsing depends on nothing the commands change, so parsing early
+// cannot change what runs; the caller still runs lines in order
+static void *helper(void *arg) {
+  AheadRep r=(AheadRep)arg;
+  pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,0);
+  for (;;) {
+    // only a read that blocks may be cancelled
+    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE,0);
+    Item item={r->read(),0,0};
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,0);
+    if (item.line) {
+      item.flat=getCache(item.line,r->parser,r->arena);
+      if (!item.flat)
+        item.error=strdup(errorParser(r->parser));
+    }
+    pthread_mutex_lock(&r->lock);
+    while (r->count==r->n && !r->stop)
+      pthread_cond_wait(&r->notfull,&r->lock);
+    if (r->stop) {
+      pthread_mutex_unlock(&r->lock);
+      free(item.line);
+      if (item.flat) dropCache(item.flat);
+      free(item.error);
+      break;
+    }
+    r->items[(r->head+r->count++)%r->n]=item;
+    pthread_cond_signal(&r->notempty);
+    pthread_mutex_unlock(&r->lock);
+    if (!item.line)
+      break;
+  }
+  return 0;
+}
+
+// This function starts parse-ahead
+// arguments:
+//   n - most lines to have parsed ahead
+//   read - function that reads the next line
+extern Ahead newAhead(int n, AheadReadF read) {
+  AheadRep r=(AheadRep)malloc(sizeof(*r));
+  if (!r)
+    ERROR("malloc() failed");
+  r->items=(Item *)malloc(sizeof(Item)*n);
+  if (!r->items)
+    ERROR("malloc() failed");
+  r->read=read;
+  r->n=n;
+  r->head=r->count=r->stop=0;
+  r->parser=newParser();
+  r->arena=newArena();
+  pthread_mutex_init(&r->lock,0);
+  pthread_cond_init(&r->notempty,0);
+  pthread_cond_init(&r->notfull,0);
+  // the helper blocks every signal, so SIGCHLD and friends
+  // still go to the thread running commands
+  sigset_t all, old;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK,&all,&old);
+  if (pthread_create(&r->thread,0,helper,r))
+    ERROR("pthread_create() failed");
+  pthread_sigmask(SIG_SETMASK,&old,0);
+  return r;
+}
+
+// This function gets the next line and its parse, in input order
+extern int nextAhead(Ahead ahead, char **line, Flat *flat, char **error) {
+  AheadRep r=(AheadRep)ahead;
+  pthread_mutex_lock(&r->lock);
+  while (!r->count)
+    pthread_cond_wait(&r->notempty,&r->lock);
+  Item item=r->items[r->head];
+  if (item.line) { // leave the end-of-input mark in place
+    r->head=(r->head+1)%r->n;
+    r->count--;
+    pthread_cond_signal(&r->notfull);
+  }
+  pthread_mutex_unlock(&r->lock);
+  *line=item.line;
+  *flat=item.flat;
+  *error=item.error;
+  return item.line!=0;
+}
+
+// This function stops the helper and frees what it left queued
+extern void freeAhead(Ahead ahead) {
+  AheadRep r=(AheadRep)ahead;
+  pthread_mutex_lock(&r->lock);
+  r->stop=1;
+  pthread_cond_broadcast(&r->notfull);
+  pthread_mutex_unlock(&r->lock);
+  pthread_cancel(r->thread); // in case it is waiting for input
+  pthread_join(r->thread,0);
+  for (; r->count; r->count--, r->head=(r->head+1)%r->n) {
+    Item *item=&r->items[r->head];
+    free(item->line);
+    if (item->flat) dropCache(item->flat);
+    free(item->error);
+  }
+  freeParser(r->parser);
+  freeArena(r->arena);
+  pthread_mutex_destroy(&r->lock);
+  pthread_cond_destroy(&r->notempty);
+  pthread_cond_destroy(&r->notfull);
+  free(r->items);
+  free(r);
+}
@@ -0,0 +1,30 @@
+/*
+ * File: ahead.h
+ * Description: Header file for parse-ahead, which reads and parses
+ * the next lines of input on a helper thread while the shell runs
+ * the current one.
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25 
+ */
+#ifndef AHEAD_H
+#define AHEAD_H
+
+#include "Flat.h"
+
+typedef void *Ahead;
+
+// Reads the next line of input: a malloc()'d line, or 0 at end of input
+typedef char *(*AheadReadF)(void);
+
+// Start a helper thread that reads lines with read and keeps up to
+// n of them parsed ahead of the caller
+extern Ahead newAhead(int n, AheadReadF read);
+// Get the next line in input order, with its parse
+// Returns 0 at end of input. Otherwise *line is the malloc()'d line
+// and either *flat is its tree from getCache() (give it back with
+// dropCache()) or *error is a malloc()'d syntax error message
+extern int nextAhead(Ahead ahead, char **line, Flat *flat, char **error);
+// Stop the helper thread and free everything it parsed
+extern void freeAhead(Ahead ahead);
+
+#endif
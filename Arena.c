@@ -0,0 +1,100 @@
+/*
+ * File: arena.c
+ * Description: Implementation of arena.h
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Arena.h"
+#include "error.h"
+
+#define BLOCKSIZE 16384 // usable bytes in an ordinary block
+
+// A block of memory handed out by bumping used
+typedef struct Block {
+  struct Block *next;
+  size_t size; // usable bytes in mem
+  size_t used; // bytes handed out so far
+  _Alignas(max_align_t) char mem[];
+} *Block;
+
+// Representation of an arena
+// Blocks are kept on reset, so once an arena has grown to fit the
+// largest parse, later parses make no calls to malloc().
+typedef struct {
+  Block head;
+  Block curr; // block we are allocating from
+} *ArenaRep;
+
+// This function allocates a block with size usable bytes
+static Block newBlock(size_t size) {
+  Block b=(Block)malloc(sizeof(*b)+size);
+  if (!b)
+    ERROR("malloc() failed");
+  b->next=0;
+  b->size=size;
+  b->used=0;
+  return b;
+}
+
+// This function creates a new empty arena
+extern Arena newArena() {
+  ArenaRep r=(ArenaRep)malloc(sizeof(*r));
+  if (!r)
+    ERROR("malloc() failed");
+  r->head=r->curr=newBlock(BLOCKSIZE);
+  return r;
+}
+
+// This function allocates zeroed memory from the arena
+// arguments:
+//   arena - the arena to allocate from
+//   size - number of bytes needed
+extern void *allocArena(Arena arena, size_t size) {
+  ArenaRep r=(ArenaRep)arena;
+  // round up so every allocation stays aligned
+  size_t align=_Alignof(max_align_t);
+  size=(size+align-1)&~(align-1);
+  Block b=r->curr;
+  // move to a later block (reusing one from before a reset if we can)
+  while (b->used+size>b->size) {
+    if (!b->next)
+      b->next=newBlock(size>BLOCKSIZE ? size : BLOCKSIZE);
+    b=b->next;
+  }
+  r->curr=b;
+  void *p=b->mem+b->used;
+  b->used+=size;
+  return memset(p,0,size);
+}
+
+// This function copies len characters of s into the arena
+extern char *strndupArena(Arena arena, char *s, int len) {
+  char *t=(char *)allocArena(arena,len+1);
+  memcpy(t,s,len); // allocArena() already zeroed t[len]
+  return t;
+}
+
+// This function releases everything allocated from the arena
+extern void resetArena(Arena arena) {
+  ArenaRep r=(ArenaRep)arena;
+  for (Block b=r->head; b; b=b->next)
+    b->used=0;
+  r->curr=r->head;
+}
+
+// This function frees the arena and all of its blocks
+extern void freeArena(Arena arena) {
+  ArenaRep r=(ArenaRep)arena;
+  Block b=r->head;
+  while (b) {
+    Block next=b->next;
+    free(b);
+    b=next;
+  }
+  free(r);
+}
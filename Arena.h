@@ -0,0 +1,26 @@
+/*
+ * File: arena.h
+ * Description: Header file for an arena allocator that hands out
+ * memory for one parse and releases all of it at once.
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25 
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h> // for size_t
+
+typedef void *Arena;
+
+// Create a new empty arena
+extern Arena newArena();
+// Allocate zeroed memory that lives until the arena is reset
+extern void *allocArena(Arena arena, size_t size);
+// Copy len characters of s into the arena, adding a NUL
+extern char *strndupArena(Arena arena, char *s, int len);
+// Release everything allocated from the arena, keeping its blocks
+extern void resetArena(Arena arena);
+// Free the arena and all of its blocks
+extern void freeArena(Arena arena);
+
+#endif
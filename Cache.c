@@ -0,0 +1,228 @@
+/*
+ * File: cache.c
+ * Description: Implementation of cache.h
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "Cache.h"
+#include "error.h"
+
+#define LIMIT (4L<<20) // default memory bound, 4 MiB
+
+// A cached line and its flat tree, in one allocation
+typedef struct Entry {
+  struct Entry *chain;  // next entry in the same hash bucket
+  struct Entry *prev;   // LRU list, most recently used first
+  struct Entry *next;
+  uint64_t hash;
+  int refs;             // users holding the tree, plus 1 while cached
+  long bytes;           // size of the whole allocation
+  char *line;           // the key, stored after the tree
+  _Alignas(max_align_t) char flat[];
+} *Entry;
+
+// The cache is shared by the whole shell
+static Entry *buckets=0;
+static int nbuckets=0;
+static int entries=0;
+static Entry mru=0; // most recently used
+static Entry lru=0; // least recently used
+static long bytes=0;
+static long limit=LIMIT;
+static long hits=0, misses=0, evictions=0;
+static pthread_mutex_t lock=PTHREAD_MUTEX_INITIALIZER;
+
+// A child forked while another thread holds the lock gets it released
+static void prefork()  { pthread_mutex_lock(&lock); }
+static void postfork() { pthread_mutex_unlock(&lock); }
+static pthread_once_t once=PTHREAD_ONCE_INIT;
+static void init() { pthread_atfork(prefork,postfork,postfork); }
+
+// This function hashes a line (64-bit FNV-1a)
+static uint64_t hash(char *s) {
+  uint64_t h=14695981039346656037ULL;
+  for (; *s; s++)
+    h=(h^(unsigned char)*s)*1099511628211ULL;
+  return h;
+}
+
+// This function gets the entry holding a tree
+static Entry entry(Flat flat) {
+  return (Entry)((char *)flat-offsetof(struct Entry,flat));
+}
+
+// This function unlinks an entry from the LRU list
+static void unlist(Entry e) {
+  if (e->prev) e->prev->next=e->next; else mru=e->next;
+  if (e->next) e->next->prev=e->prev; else lru=e->prev;
+}
+
+// This function links an entry at the front of the LRU list
+static void list(Entry e) {
+  e->prev=0;
+  e->next=mru;
+  if (mru) mru->prev=e; else lru=e;
+  mru=e;
+}
+
+// This function drops one reference to an entry, freeing it at zero
+static void unref(Entry e) {
+  if (--e->refs==0)
+    free(e);
+}
+
+// This function removes an entry from the cache
+static void evict(Entry e) {
+  Entry *p=&buckets[e->hash&(nbuckets-1)];
+  while (*p!=e)
+    p=&(*p)->chain;
+  *p=e->chain;
+  unlist(e);
+  entries--;
+  bytes-=e->bytes;
+  unref(e); // still alive if a user holds the tree
+}
+
+// This function doubles the hash table
+static void grow() {
+  int n=nbuckets ? 2*nbuckets : 64;
+  Entry *b=(Entry *)calloc(n,sizeof(*b));
+  if (!b)
+    ERROR("calloc() failed");
+  for (int i=0; i<nbuckets; i++)
+    while (buckets[i]) {
+      Entry e=buckets[i];
+      buckets[i]=e->chain;
+      e->chain=b[e->hash&(n-1)];
+      b[e->hash&(n-1)]=e;
+    }
+  free(buckets);
+  buckets=b;
+  nbuckets=n;
+}
+
+// This function finds the entry for a line, or returns 0
+static Entry find(uint64_t h, char *line) {
+  if (nbuckets)
+    for (Entry e=buckets[h&(nbuckets-1)]; e; e=e->chain)
+      if (e->hash==h && !strcmp(e->line,line))
+        return e;
+  return 0;
+}
+
+// This function gets the flat parse tree for a line
+// On a hit the line is neither scanned nor parsed
+// arguments:
+//   line - the line to look up
+//   parser - parser to use on a miss
+//   arena - memory for the linked tree on a miss
+extern Flat getCache(char *line, Parser parser, Arena arena) {
+  pthread_once(&once,init);
+  uint64_t h=hash(line);
+  pthread_mutex_lock(&lock);
+  Entry e=find(h,line);
+  if (e) {
+    hits++;
+    unlist(e); // move to the front of the LRU list
+    list(e);
+    e->refs++;
+    pthread_mutex_unlock(&lock);
+    return e->flat;
+  }
+  misses++;
+  pthread_mutex_unlock(&lock);
+  // Parse the line, without the lock, and copy its tree into a new entry
+  Tree tree=parseParser(parser,line,arena);
+  if (errorParser(parser)) {
+    resetArena(arena);
+    return 0;
+  }
+  Flat flat=flattenTree(tree);
+  resetArena(arena);
+  int size=sizeFlat(flat);
+  int len=strlen(line)+1;
+  e=(Entry)malloc(sizeof(*e)+size+len);
+  if (!e)
+    ERROR("malloc() failed");
+  memcpy(e->flat,flat,size);
+  freeFlat(flat);
+  e->line=e->flat+size;
+  memcpy(e->line,line,len);
+  e->hash=h;
+  e->bytes=sizeof(*e)+size+len;
+  e->refs=1; // the caller's reference
+  pthread_mutex_lock(&lock);
+  if (e->bytes>limit || find(h,line)) {
+    // too big to keep, or another thread just added the line:
+    // the caller owns this copy alone
+    pthread_mutex_unlock(&lock);
+    return e->flat;
+  }
+  // Make room, then add the entry
+  while (lru && bytes+e->bytes>limit) {
+    evictions++;
+    evict(lru);
+  }
+  if (entries>=nbuckets)
+    grow();
+  e->refs++; // the cache's reference
+  e->chain=buckets[h&(nbuckets-1)];
+  buckets[h&(nbuckets-1)]=e;
+  list(e);
+  entries++;
+  bytes+=e->bytes;
+  pthread_mutex_unlock(&lock);
+  return e->flat;
+}
+
+// This function gives back a tree returned by getCache()
+extern void dropCache(Flat flat) {
+  pthread_mutex_lock(&lock);
+  unref(entry(flat));
+  pthread_mutex_unlock(&lock);
+}
+
+// This function sets the memory bound, evicting to fit it
+extern void limitCache(long b) {
+  pthread_mutex_lock(&lock);
+  limit=b<0 ? 0 : b;
+  while (lru && bytes>limit) {
+    evictions++;
+    evict(lru);
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+// This function removes every line from the cache
+extern void clearCache() {
+  pthread_mutex_lock(&lock);
+  while (lru)
+    evict(lru);
+  pthread_mutex_unlock(&lock);
+}
+
+// This function prints the cache counters
+extern void printCache(FILE *out) {
+  pthread_mutex_lock(&lock);
+  fprintf(out,"hits %ld misses %ld evictions %ld entries %d bytes %ld limit %ld\n",
+         hits,misses,evictions,entries,bytes,limit);
+  pthread_mutex_unlock(&lock);
+}
+
+// This function frees the cache
+extern void freeCache() {
+  clearCache();
+  pthread_mutex_lock(&lock);
+  free(buckets);
+  buckets=0;
+  nbuckets=0;
+  pthread_mutex_unlock(&lock);
+}
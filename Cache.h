@@ -0,0 +1,33 @@
+/*
+ * File: cache.h
+ * Description: Header file for the parse cache, an LRU cache of
+ * flat parse trees keyed by the text of the line.
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25 
+ */
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "Arena.h"
+#include "Flat.h"
+#include "Parser.h"
+#include <stdio.h>
+
+// The cache may be used by several threads at once
+
+// Get the flat parse tree for a line, parsing it with parser (in arena)
+// on a miss; returns 0 on a syntax error, with errorParser() set
+// The tree is shared and must not be changed; give it back with dropCache()
+extern Flat getCache(char *line, Parser parser, Arena arena);
+// Give back a tree returned by getCache()
+extern void dropCache(Flat flat);
+// Set the most memory the cache may hold, in bytes (0 disables it)
+extern void limitCache(long bytes);
+// Remove every line from the cache
+extern void clearCache();
+// Print the cache counters
+extern void printCache(FILE *out);
+// Free the cache
+extern void freeCache();
+
+#endif
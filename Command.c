@@ -15,8 +15,16 @@
 #include <fcntl.h> // for open()
 #include <readline/history.h>
 #include <signal.h>
+#include <spawn.h>
+#include <errno.h>
+#include <paths.h> // for _PATH_BSHELL
 #include "Interpreter.h"
 #include "Sequence.h"
+#include "Cache.h"
+#include "Path.h"
+#include "Utility.h"
+#include "Parallel.h"
+#include "Zygote.h"
 
 // This structure represents a command
 typedef struct {
@@ -26,27 +34,41 @@ typedef struct {
   char *outfile;
   T_sequence block;
   int subshell;
+  Flat flat; // the block as a flat tree and node index, if flat != 0
+  int fblock;
+  int packed; // 1 if argv and its strings are one allocation
 } *CommandRep;
 
 // Macros to define built-in commands
-#define BIARGS CommandRep r, int *eof, Jobs jobs
+#define BIARGS CommandRep r, int *eof, Jobs jobs, FILE *out
 #define BINAME(name) bi_##name
 #define BIDEFN(name) static void BINAME(name) (BIARGS)
-#define BIENTRY(name) {#name,BINAME(name)}
+#define BIENTRY(name) {#name,BINAME(name),0}
+// A pure built-in only writes to out: in a pipeline it runs on a thread
+#define BIPURE(name) {#name,BINAME(name),1}
+// A built-in standing in for a program that copies data takes only
+// the options opts; with others, the program runs
+#define BICOPY(name,opts) {#name,BINAME(name),0,opts}
 
 static char *owd=0;
 static char *cwd=0;
+static __thread int status=0; // exit status of the last built-in
 
 // Validate the number of arguments for built-in commands
-static void builtin_args(CommandRep r, int n) {
+// Returns 0, with an error reported, if it is wrong
+static int builtin_args(CommandRep r, int n) {
   if (!r->argv) {
     ERROR("NULL argv in builtin command");
-    return;
+    return 0;
   }
   char **argv=r->argv;
   for (n++; *argv++; n--);
-  if (n)
-    ERROR("wrong number of arguments to builtin command"); // warn
+  if (n) {
+    WARNLOC(__FILE__,__LINE__,"error",
+            "wrong number of arguments to builtin command"); // warn
+    status=2;
+  }
+  return !n;
 }
 
 // Exit the shell
@@ -57,15 +79,17 @@ BIDEFN(exit) {
 
 // Print the current working directory
 BIDEFN(pwd) {
-  builtin_args(r,0);
+  if (!builtin_args(r,0))
+    return;
   if (!cwd)
     cwd=getcwd(0,0);
-  printf("%s\n",cwd);
+  fprintf(out,"%s\n",cwd);
 }
 
 // Change the current working directory
 BIDEFN(cd) {
-  builtin_args(r,1);
+  if (!builtin_args(r,1))
+    return;
   // change to old working directory
   if (strcmp(r->argv[1],"-")==0) { 
     char *twd=cwd;
@@ -82,61 +106,333 @@ BIDEFN(cd) {
 
 // Print command history
 BIDEFN(history) {
-  builtin_args(r,0);
+  if (!builtin_args(r,0))
+    return;
   // Print the history list
   HIST_ENTRY **hist = history_list();
   if (hist) { // if history exists
     for (int i = 0; hist[i]; i++)
-      printf("%5d: %s\n", i + history_base, hist[i]->line);
+      fprintf(out,"%5d: %s\n", i + history_base, hist[i]->line);
   }
 }
 
 // Print the list of jobs
+//   jobs          print each job's state; ended ones are reported once
+//   jobs -l       and the resource usage of each job's processes
+//   jobs -m n     keep at most n ended jobs until they are reported
 BIDEFN(jobs) {
-  builtin_args(r,0); // Validate arguments
-  printJobs(jobs); // Call the printJobs function
+  if (r->argv[1] && !strcmp(r->argv[1],"-m")) {
+    if (!builtin_args(r,2)) // Validate arguments
+      return;
+    limitJobs(jobs,atoi(r->argv[2]));
+    return;
+  }
+  int lng=r->argv[1] && !strcmp(r->argv[1],"-l");
+  if (!builtin_args(r,lng)) // Validate arguments
+    return;
+  printJobs(jobs,out,lng); // Call the printJobs function
 }
 
 // Bring a job to the foreground
 BIDEFN(fg) {
-  builtin_args(r,1); // Validate arguments
+  if (!builtin_args(r,1)) // Validate arguments
+    return;
   int job_id = atoi(r->argv[1]); // Convert job ID from string to integer
   foregroundJob(jobs, job_id); // Call the foregroundJob function
 }
 // Send a job to the background
 BIDEFN(bg) { 
-  builtin_args(r,1); // Validate arguments
+  if (!builtin_args(r,1)) // Validate arguments
+    return;
   int job_id = atoi(r->argv[1]); // Convert job ID from string to integer
   backgroundJob(jobs, job_id);// Call the backgroundJob function
 }
 
-// Check and execute built-in commands
-static int builtin(BIARGS) {
-  typedef struct {
-    char *s;
-    void (*f)(BIARGS);
-  } Builtin;
-  static const Builtin builtins[]={
-    BIENTRY(exit),
-    BIENTRY(pwd),
-    BIENTRY(cd),
-    BIENTRY(history),
-    BIENTRY(jobs),
-    BIENTRY(fg),
-    BIENTRY(bg),
-    {0,0}
-  };
+// Wait for background jobs to end
+// Usage: wait [-n] [-t seconds] [%job ...]
+//   with no job, for all of them; with -n, for the first to end; with
+//   -t, for at most that long (then the status is 124)
+BIDEFN(wait) {
+  char **argv=r->argv+1;
+  int any=0, timeout=-1, n=0;
+  for (; *argv && **argv=='-'; argv++)
+    if (!strcmp(*argv,"-n"))
+      any=1;
+    else if (!strcmp(*argv,"-t") && argv[1]) {
+      char *end;
+      double t=strtod(*++argv,&end);
+      if (*end || t<0)
+        break;
+      timeout=t*1000;
+    } else
+      break;
+  while (argv[n])
+    n++;
+  int ids[n+1];
+  for (int i=0; i<n; i++) {
+    char *end;
+    ids[i]=strtol(argv[i]+(*argv[i]=='%'),&end,10);
+    if (*end || ids[i]<=0) {
+      fprintf(stderr, "wait: usage: wait [-n] [-t seconds] [%%job ...]\n");
+      status=2;
+      return;
+    }
+  }
+  status=waitJobs(jobs,n ? ids : 0,n,any,timeout,0);
+  if (n==1 && status==127)
+    fprintf(stderr, "wait: job %d not found\n", ids[0]);
+}
+
+// Run a command for each input line, N at a time (see parallel.h)
+BIDEFN(parallel) {
+  status=execParallel(out,r->argv,jobs,eof);
+}
+
+// Print or change the parse cache
+//   parsecache          print hits, misses, evictions and bytes
+//   parsecache -c       empty the cache
+//   parsecache -m bytes bound the memory the cache may hold
+BIDEFN(parsecache) {
+  char **argv=r->argv;
+  if (!argv[1])
+    printCache(out);
+  else if (!strcmp(argv[1],"-c") && !argv[2])
+    clearCache();
+  else if (!strcmp(argv[1],"-m") && argv[2] && !argv[3]) {
+    char *end;
+    long bytes=strtol(argv[2],&end,10);
+    if (*end || end==argv[2] || bytes<0) {
+      fprintf(stderr, "parsecache: usage: parsecache [-c | -m bytes]\n");
+      status=2;
+      return;
+    }
+    limitCache(bytes);
+  } else {
+    fprintf(stderr, "parsecache: usage: parsecache [-c | -m bytes]\n");
+    status=2;
+  }
+}
+
+// Show or change the table of where commands are
+// Usage: hash           list the table with hit counts
+//        hash -r        empty the table
+//        hash name ...  look up names and add them
+BIDEFN(hash) {
+  char **argv=r->argv;
+  if (!argv[1])
+    printPath(out);
+  else if (!strcmp(argv[1],"-r") && !argv[2])
+    clearPath();
+  else
+    for (argv++; *argv; argv++)
+      if (!findPath(*argv))
+        fprintf(stderr, "hash: %s: not found\n", *argv);
+}
+
+// Show or change the buffer size of the pipes of pipelines
+// Usage: pipesize        print it
+//        pipesize bytes  set it (0 for the kernel's default) and print
+//                        what applies
+BIDEFN(pipesize) {
+  char **argv=r->argv;
+  char *end=0;
+  long bytes=argv[1] ? strtol(argv[1],&end,10) : -1;
+  if ((argv[1] && (*end || bytes<0)) || (argv[1] && argv[2])) {
+    fprintf(stderr, "pipesize: usage: pipesize [bytes]\n");
+    status=2;
+    return;
+  }
+  fprintf(out,"%ld\n",bufferPipeline(bytes));
+}
+
+// Write arguments, as coreutils echo does
+BIDEFN(echo) {
+  status=echoUtility(out,r->argv);
+}
+
+// Write arguments by a format, as coreutils printf does
+BIDEFN(printf) {
+  status=printfUtility(out,r->argv);
+}
+
+// Do nothing, successfully
+BIDEFN(true) {
+  status=0;
+}
+
+// Do nothing, unsuccessfully
+BIDEFN(false) {
+  status=1;
+}
+
+// Evaluate an expression, as coreutils test and [ do
+BIDEFN(test) {
+  status=testUtility(r->argv);
+}
+
+// Copy files, or standard input, to out, as coreutils cat does
+BIDEFN(cat) {
+  status=catUtility(out,r->argv);
+}
+
+// Copy standard input to out and files, as coreutils tee does
+BIDEFN(tee) {
+  status=teeUtility(out,r->argv);
+}
+
+// The built-in commands
+typedef struct {
+  char *s;
+  void (*f)(BIARGS);
+  int pure; // 1 if it only writes output
+  char *opts; // the options it takes, if it copies data
+} Builtin;
+static const Builtin builtins[]={
+  BIENTRY(exit),
+  BIPURE(pwd),
+  BIENTRY(cd),
+  BIPURE(history),
+  BIPURE(jobs),
+  BIENTRY(fg),
+  BIENTRY(bg),
+  BIENTRY(wait),
+  BIENTRY(parallel),
+  BIENTRY(parsecache),
+  BIENTRY(hash),
+  BIENTRY(pipesize),
+  BIPURE(echo),
+  BIPURE(printf),
+  BIPURE(true),
+  BIPURE(false),
+  BIPURE(test),
+  {"[",BINAME(test),1},
+  BICOPY(cat,"u"),
+  BICOPY(tee,"ai"),
+  {0,0,0}
+};
+
+// Tell whether built-in b takes the options of argv (all do, but
+// those that copy data)
+static int takes(const Builtin *b, char **argv) {
+  if (!b->opts || !argv)
+    return 1;
+  for (argv++; *argv && **argv=='-' && (*argv)[1]; argv++) {
+    if (!strcmp(*argv,"--"))
+      break;
+    for (char *o=*argv+1; *o; o++)
+      if (!strchr(b->opts,*o))
+        return 0;
+  }
+  return 1;
+}
+
+// Find the built-in command r runs, or return 0
+static const Builtin *findBuiltin(CommandRep r) {
   if (!r->file)
     return 0;
   int i;
   for (i=0; builtins[i].s; i++)
-    if (!strcmp(r->file,builtins[i].s)) {
-      builtins[i].f(r,eof,jobs);
-      return 1;
-    }
+    if (!strcmp(r->file,builtins[i].s))
+      return takes(&builtins[i],r->argv) ? &builtins[i] : 0;
   return 0;
 }
 
+// Check and execute built-in commands
+static int builtin(BIARGS) {
+  const Builtin *b=findBuiltin(r);
+  if (b)
+    b->f(r,eof,jobs,out);
+  return b!=0;
+}
+
+static char **params=0; // $0, $1, ... of a script or -c, 0 otherwise
+static int nparams=0;
+
+// This function sets the positional parameters (argv[0] is $0)
+extern void paramsCommand(int argc, char **argv) {
+  params=argv;
+  nparams=argc;
+}
+
+// Substitute $0-$9, $# and $@ (or $*) in a word, but not between
+// single quotes (which stay in the word, as all quotes do)
+// Returns a malloc()'d string, or 0 if there is nothing to substitute
+static char *subst(char *w) {
+  if (!w || !params || !strchr(w,'$'))
+    return 0;
+  char *s;
+  size_t len;
+  FILE *out=open_memstream(&s,&len); // grows as we write
+  if (!out)
+    ERROR("open_memstream() failed");
+  char quote=0; // the quote we are between, if any
+  for (; *w; w++) {
+    if ((*w=='\'' || *w=='"') && (!quote || quote==*w))
+      quote=quote ? 0 : *w;
+    if (*w!='$' || !w[1] || quote=='\'') { // not a parameter
+      fputc(*w,out);
+      continue;
+    }
+    char c=*++w;
+    if (c>='0' && c<='9') { // $0-$9, empty if not given
+      if (c-'0'<nparams)
+        fputs(params[c-'0'],out);
+    } else if (c=='#') // number of parameters
+      fprintf(out,"%d",nparams-1);
+    else if (c=='@' || c=='*') // all of them, space-separated
+      for (int i=1; i<nparams; i++)
+        fprintf(out,i>1 ? " %s" : "%s",params[i]);
+    else { // not a parameter
+      fputc('$',out);
+      fputc(c,out);
+    }
+  }
+  fclose(out);
+  return s;
+}
+
+// Tell whether a word is just $@ (or $*)
+static int whole(char *w) {
+  return !strcmp(w,"$@") || !strcmp(w,"$*");
+}
+
+// Substitute positional parameters in an argv array
+// A word that is just $@ (or $*) becomes one argument per parameter
+static char **expand(char **argv, int *packed) {
+  if (!params)
+    return argv;
+  int n=0, some=0, all=0; // (all: words that are just $@ or $*)
+  for (; argv[n]; n++) {
+    some|=strchr(argv[n],'$')!=0;
+    all+=whole(argv[n]);
+  }
+  if (!some)
+    return argv;
+  // each $@ becomes nparams-1 words, and every other word one
+  char **new=(char **)malloc(sizeof(char *)*(n-all+all*(nparams-1)+1));
+  if (!new)
+    ERROR("malloc() failed");
+  int j=0;
+  for (int i=0; i<n; i++) {
+    if (whole(argv[i])) {
+      for (int k=1; k<nparams; k++)
+        if (!(new[j++]=strdup(params[k])))
+          ERROR("strdup() failed");
+      continue;
+    }
+    char *s=subst(argv[i]);
+    new[j++]=s ? s : strdup(argv[i]);
+    if (!new[j-1])
+      ERROR("strdup() failed");
+  }
+  new[j]=0;
+  for (int i=0; i<n && !*packed; i++) // packed strings go with the array
+    free(argv[i]);
+  free(argv);
+  *packed=0;
+  return new;
+}
+
 // Convert T_words to argv array
 static char **getargs(T_words words) {
   int n=0; 
@@ -159,6 +455,25 @@ static char **getargs(T_words words) {
   return argv; // Return the argv array
 }
 
+// Convert argc adjacent strings to an argv array
+// The strings are copied with argv in one allocation
+static char **getargsFlat(char *words, int argc) {
+  char *end=words; // find the end of the last string
+  for (int i=0; i<argc; i++)
+    end+=strlen(end)+1;
+  int bytes=end-words;
+  char **argv=(char **)malloc(sizeof(char *)*(argc+1)+bytes);
+  if (!argv)
+    ERROR("malloc() failed");
+  char *p=memcpy(argv+argc+1,words,bytes); // strings follow the array
+  for (int i=0; i<argc; i++) {
+    argv[i]=p;
+    p+=strlen(p)+1;
+  }
+  argv[argc]=0;
+  return argv;
+}
+
 // Create a new Command
 // args: words: T_words representing command and arguments
 //       infile: input redirection file (or NULL)
@@ -168,8 +483,9 @@ extern Command newCommand(T_words words, char *infile, char *outfile) {
   if (!r)
     ERROR("malloc() failed");
 
+  r->packed = 0;
   if (words){ // if words is not null
-    r->argv=getargs(words); // convert T_words to argv array
+    r->argv=expand(getargs(words),&r->packed); // convert T_words to argv array
     r->file=r->argv[0]; // first argument is the command name
   }
   else{ // if words is null
@@ -178,13 +494,56 @@ extern Command newCommand(T_words words, char *infile, char *outfile) {
   }
   // if infile or outfile is null, set to 0
   // else strdup it
-  r->infile=infile ? strdup(infile) : 0; 
-  r->outfile=outfile ? strdup(outfile) : 0;
+  // (positional parameters are substituted in them)
+  char *s;
+  r->infile=(s=subst(infile)) ? s : infile ? strdup(infile) : 0; 
+  r->outfile=(s=subst(outfile)) ? s : outfile ? strdup(outfile) : 0;
   r->block = 0; 
   r->subshell = -1; // -1 = not a subshell or compound
+  r->flat = 0;
+  r->fblock = -1;
   return r; // return the new Command
 }
 
+// Create a new Command from a flat tree
+// args: argv: first of argc adjacent strings, the command and arguments
+//       argc: number of strings, 0 for a block
+//       infile: input redirection file (or NULL)
+//       outfile: output redirection file (or NULL)
+extern Command newCommandFlat(char *argv, int argc, char *infile, char *outfile) {
+  CommandRep r=newCommand(0,infile,outfile);
+  if (argc) {
+    r->packed=1;
+    r->argv=expand(getargsFlat(argv,argc),&r->packed);
+    r->file=r->argv[0];
+  }
+  return r;
+}
+
+// Interpret the block of a ( ) or { } command into a Sequence
+static void block(CommandRep r, Sequence seq) {
+  if (r->flat)
+    i_flat(r->flat,r->fblock,seq); // interpret flat block into Sequence
+  else
+    i_sequence(r->block,seq); // interpret T_sequence into Sequence
+}
+
+// This function builds the words that run a file without #! as a
+// script of /bin/sh, as execvp() does when the kernel says ENOEXEC:
+// the shell, the file, then the command's arguments
+static char **script(char *file, char **argv) {
+  int n=0;
+  while (argv[n])
+    n++;
+  char **words=malloc((n+2)*sizeof(*words));
+  if (!words)
+    ERROR("malloc() failed");
+  words[0]=_PATH_BSHELL;
+  words[1]=file;
+  memcpy(words+2,argv+1,n*sizeof(*words)); // (with the null)
+  return words;
+}
+
 // This function handles the execution of a command in a child process
 // It sets up input/output redirection and executes the command
 //  arguments:
@@ -233,24 +592,193 @@ static void child(CommandRep r, int fg, int pipe_in, int pipe_out) {
     close(fd); // we close the original file descriptor
   }
   // Handle built-in commands
-  if (builtin(r,&eof,jobs)) // If the command is a built-in
+  status=0;
+  if (builtin(r,&eof,jobs,stdout)) // If the command is a built-in
     //return;
-    exit(0); // Exit child process after executing built-in command
+    exit(status); // Exit child process after executing built-in command
   if (!r->argv || !r->argv[0]) { // Check if command is NULL
     ERROR("NULL command in execvp");
     exit(1); // Exit with error
   }
-  execvp(r->argv[0],r->argv); // Execute the command
+  char *file=findPath(r->argv[0]); // where PATH says it is
+  if (file) {
+    execv(file,r->argv); // Execute the command
+    if (errno==ENOEXEC) // no #!: run it with /bin/sh
+      execv(_PATH_BSHELL,script(file,r->argv));
+  }
   ERROR("execvp() failed"); 
   exit(0);
 }
 
+static int spawning=1; // 1 to launch external commands with posix_spawnp()
+
+// This function chooses how external commands are launched
+extern void spawnCommand(int on) {
+  spawning=on;
+}
+
+// This function launches a file through the zygote, if there is one,
+// else with posix_spawn()
+// Returns 0, or the error number
+static int launch(pid_t *pid, char *file, char **argv, int fds[3],
+                  pid_t pgid, posix_spawn_file_actions_t *fa,
+                  posix_spawnattr_t *attr) {
+  extern char **environ;
+  int err=launchZygote(pid,file,argv,fds,pgid); // -1: no zygote
+  if (err==-1)
+    err=posix_spawn(pid,file,fa,attr,argv,environ);
+  return err;
+}
+
+// This function launches an external command with posix_spawnp()
+// The pipe dup2()s, redirections and signal resets of child() become
+// spawn file actions and attributes, so the shell's memory is never
+// copied (glibc spawns with CLONE_VM|CLONE_VFORK)
+// Returns the pid, or -1 if the command could not be launched
+//  arguments:
+//   r: CommandRep representing the command to execute
+//   pgid: process group to put it in (0 for its own), -1 to leave it
+//   pipe_in: file descriptor for input pipe
+//   pipe_out: file descriptor for output pipe
+static pid_t spawn(CommandRep r, pid_t pgid, int pipe_in, int pipe_out) {
+  // Open the redirections here, where a failure can be reported
+  int in=-1, out=-1;
+  if (r->infile && (in=open(r->infile,O_RDONLY|O_CLOEXEC))<0) {
+    WARNLOC(__FILE__,__LINE__,"error","Failed to open input file");
+    return -1;
+  }
+  if (r->outfile &&
+      (out=open(r->outfile,O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC,0666))<0) {
+    WARNLOC(__FILE__,__LINE__,"error","Failed to open output file");
+    if (in!=-1)
+      close(in);
+    return -1;
+  }
+  posix_spawn_file_actions_t fa;
+  posix_spawn_file_actions_init(&fa);
+  if (pipe_in != -1) { // redirect standard input to pipe input
+    posix_spawn_file_actions_adddup2(&fa,pipe_in,STDIN_FILENO);
+    posix_spawn_file_actions_addclose(&fa,pipe_in);
+  }
+  if (pipe_out != -1) { // redirect standard output to pipe output
+    posix_spawn_file_actions_adddup2(&fa,pipe_out,STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&fa,pipe_out);
+  }
+  if (in != -1) // then to the input file (the open one is close-on-exec)
+    posix_spawn_file_actions_adddup2(&fa,in,STDIN_FILENO);
+  if (out != -1) // and the output file
+    posix_spawn_file_actions_adddup2(&fa,out,STDOUT_FILENO);
+
+  // Restore default handlers for Ctrl+Z and Ctrl+C
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  sigset_t def;
+  sigemptyset(&def);
+  sigaddset(&def,SIGTSTP);
+  sigaddset(&def,SIGINT);
+  posix_spawnattr_setsigdefault(&attr,&def);
+  sigset_t none; // and unblock SIGCHLD, held while a pipeline starts
+  sigemptyset(&none);
+  posix_spawnattr_setsigmask(&attr,&none);
+  short flags=POSIX_SPAWN_SETSIGDEF|POSIX_SPAWN_SETSIGMASK;
+  if (pgid != -1) { // join the pipeline's process group
+    posix_spawnattr_setpgroup(&attr,pgid);
+    flags|=POSIX_SPAWN_SETPGROUP;
+  }
+  posix_spawnattr_setflags(&attr,flags);
+
+  // Spawn the file PATH names, or fail at once if there is none;
+  // if the file has gone, forget it and search PATH again
+  // With a zygote, it launches the file instead, with the same
+  // descriptors and process group; a file without #! is run by /bin/sh
+  int fds[3]={in!=-1 ? in : pipe_in!=-1 ? pipe_in : STDIN_FILENO,
+              out!=-1 ? out : pipe_out!=-1 ? pipe_out : STDOUT_FILENO,
+              STDERR_FILENO};
+  pid_t pid;
+  int err=ENOENT;
+  for (int tries=0; err==ENOENT && tries<2; tries++) {
+    char *file=findPath(r->argv[0]);
+    if (!file)
+      break;
+    err=launch(&pid,file,r->argv,fds,pgid,&fa,&attr);
+    if (err==ENOEXEC) {
+      char **argv=script(file,r->argv);
+      err=launch(&pid,_PATH_BSHELL,argv,fds,pgid,&fa,&attr);
+      free(argv);
+    }
+    if (err==ENOENT)
+      forgetPath(r->argv[0]);
+  }
+  posix_spawn_file_actions_destroy(&fa);
+  posix_spawnattr_destroy(&attr);
+  if (in != -1)
+    close(in);
+  if (out != -1)
+    close(out);
+  if (err) {
+    WARNLOC(__FILE__,__LINE__,"error","%s: %s",r->argv[0],
+            err==ENOENT ? "command not found" : strerror(err));
+    return -1;
+  }
+  return pid;
+}
+
+// This function points stdin and stdout at a command's < and > files,
+// saving the old ones in saved (-1 if not redirected)
+// Returns 0, with nothing changed, if a file cannot be opened
+static int redirect(CommandRep r, int saved[2]) {
+  int fd[2]={-1,-1};
+  if (r->infile && (fd[0]=open(r->infile,O_RDONLY|O_CLOEXEC))<0) {
+    WARNLOC(__FILE__,__LINE__,"error","Failed to open input file");
+    return 0;
+  }
+  if (r->outfile &&
+      (fd[1]=open(r->outfile,O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC,0666))<0) {
+    WARNLOC(__FILE__,__LINE__,"error","Failed to open output file");
+    if (fd[0]!=-1)
+      close(fd[0]);
+    return 0;
+  }
+  fflush(stdout); // what is buffered goes where it was meant to
+  for (int i=0; i<2; i++) {
+    saved[i]=-1;
+    if (fd[i]!=-1) {
+      saved[i]=fcntl(i,F_DUPFD_CLOEXEC,10); // out of the way
+      dup2(fd[i],i);
+      close(fd[i]);
+    }
+  }
+  return 1;
+}
+
+// This function puts back the stdin and stdout saved by redirect()
+static void restore(int saved[2]) {
+  fflush(stdout);
+  for (int i=0; i<2; i++)
+    if (saved[i]!=-1) {
+      dup2(saved[i],i);
+      close(saved[i]);
+    }
+}
+
+// This function tells whether the shell has a controlling terminal,
+// whose ^C and ^Z should reach a long-running built-in
+static int terminal() {
+  if (isatty(STDIN_FILENO) || isatty(STDERR_FILENO))
+    return 1;
+  int fd=open("/dev/tty",O_RDONLY|O_NOCTTY|O_CLOEXEC);
+  if (fd==-1)
+    return 0;
+  close(fd);
+  return 1;
+}
+
 // Execute a command
 // Arguments:
 //   command: The command to execute
 //   pipeline: The pipeline the command belongs to
 //   jobs: The jobs collection
-//   jobbed: pointer to int indicating if the job has been added to jobs
+//   jobbed: pointer to the job's ID once it has been added to jobs, else 0
 //   eof: pointer to int indicating end-of-file
 //   fg: int indicating if the command is in the foreground (1) or background (0)
 //   pipe_in: file descriptor for input pipe
@@ -259,19 +787,17 @@ extern pid_t execCommand(Command command, Pipeline pipeline, Jobs jobs,
 			int *jobbed, int *eof, int fg, int pipe_in, int pipe_out) {
   CommandRep r=command; // cast to CommandRep  
   // Handle block commands either ( ) or { }
-  if (r->block) {
+  if (r->block || r->flat) {
     if (r->subshell == 0) {  // { } - no subshell
       // Execute block in current process
       Sequence seq=newSequence(); // create new Sequence
-      i_sequence(r->block, seq); // interpret T_sequence into Sequence
+      block(r, seq); // interpret the block into Sequence
       execSequence(seq, jobs, eof); // execute the sequence
       return 0;
     } 
     else if (r->subshell == 1) { // ( ) - fork subshell
-      if (!*jobbed) { // if job not yet added
-        *jobbed=1; // mark as added
-        addJobs(jobs,pipeline); // add pipeline to jobs
-      }
+      if (!*jobbed) // if job not yet added: add pipeline to jobs
+        *jobbed=addJobs(jobs,pipeline); // (its ID marks it as added)
       
       // Fork a new process for the subshell
       int pid=fork(); 
@@ -293,63 +819,215 @@ extern pid_t execCommand(Command command, Pipeline pipeline, Jobs jobs,
           close(pipe_out); // we close original pipe output descriptor
         }
         
-        // Execute the block in the subshell
-        Sequence seq=newSequence(); // create new Sequence
-        i_sequence(r->block, seq); // interpret T_sequence into Sequence
-        execSequence(seq, jobs, eof); // execute the sequence
-        exit(0);
+        // Execute the block in the subshell; its last command
+        // replaces the subshell instead of being forked from it
+        tailCommand(r, jobs, eof);
       }
       
-      // Parent process
-      if (fg) { // If foreground
-        int status; // we store the status of the process
-        // Add WUNTRACED flag for waitpid
-        // We use WUNTRACED to detect if the process is stopped
-        waitpid(pid, &status, WUNTRACED); 
-        // Check if stopped
-        if (WIFSTOPPED(status)) {
-          markJobStopped(jobs); // mark the job as stopped
-          printf("\n");
-        }
-      }
+      // Parent process: the pipeline waits for it, if foreground
       return pid; //we return the pid of the subshell
     }
   }
 
   // Handle non-block commands
-  // if foreground and no pipes and built-in command
-  if (fg && pipe_in == -1 && pipe_out == -1 && builtin(r,eof,jobs)){
+  // if foreground and no pipes and built-in command: run it here,
+  // with its redirections swapped in for the while (but one copying
+  // data gets a process if there is a terminal: ^C and ^Z can stop it)
+  const Builtin *b=findBuiltin(r);
+  if (fg && pipe_in == -1 && pipe_out == -1 && b &&
+      !(b->opts && terminal())) {
+    int saved[2];
+    if (redirect(r,saved)) {
+      status=0;
+      builtin(r,eof,jobs,stdout);
+      restore(saved);
+    }
     fflush(stdout); // flush stdout for correct output order
     return 0;
   }
-  // For other commands
-  if (!*jobbed) { // if job not yet added
-    *jobbed=1; // mark as added
-    addJobs(jobs,pipeline); // add pipeline to jobs
-  }
-  // Fork a new process to execute the command
-  int pid=fork(); // create a new process
+  // For other commands: spawn external ones, fork for built-ins
+  int pid=-1;
+  if (spawning && r->argv && r->argv[0] && !findBuiltin(r) &&
+      (pid=spawn(r,-1,pipe_in,pipe_out))==-1)
+    return 0; // could not launch: no job
+  if (!*jobbed) // if job not yet added: add pipeline to jobs
+    *jobbed=addJobs(jobs,pipeline); // (its ID marks it as added)
+  // Fork a new process to execute the command, unless spawned
+  if (pid==-1)
+    pid=fork(); // create a new process
   if (pid==-1)
     ERROR("fork() failed");
   // Child process
   if (pid==0)
     child(r,fg, pipe_in, pipe_out); // execute the command in child 
-  else { // Parent process
-    if (fg) { // If foreground
-      int status;// we store the status of the process
-      waitpid(pid, &status, WUNTRACED);  // Add WUNTRACED flag for waitpid
-      
-      // Check if stopped
-      if (WIFSTOPPED(status)) {
-        markJobStopped(jobs);  // Mark the job as stopped
-        printf("\n");
-      }
-    }
+  else { // Parent process: the pipeline waits for it, if foreground
     return pid; // return the pid of the command
   }
   return 0; 
 }
 
+// Launch a stage of a pipeline straight from the shell, if it is an
+// external command; built-ins and blocks need a forked process
+// Returns the pid, 0 if the stage must be forked, or -1 if it could
+// not be launched (which has been reported)
+// Arguments:
+//   command: the stage to launch
+//   pgid: the pipeline's process group, 0 to start a new one
+//   pipe_in: file descriptor for input pipe
+//   pipe_out: file descriptor for output pipe
+extern pid_t launchCommand(Command command, pid_t pgid,
+                           int pipe_in, int pipe_out) {
+  CommandRep r=command; // cast to CommandRep
+  if (!spawning || r->block || r->flat || !r->argv || !r->argv[0] ||
+      findBuiltin(r))
+    return 0; // fork for it
+  return spawn(r,pgid,pipe_in,pipe_out);
+}
+
+// Run a stage of a pipeline in the process forked for it
+// A block runs right here, anything else as in child(); never returns
+// Arguments:
+//   command: the stage to run
+//   jobs: the jobs collection
+//   eof: pointer to int indicating end-of-file
+//   pipe_in: file descriptor for input pipe
+//   pipe_out: file descriptor for output pipe
+extern void stageCommand(Command command, Jobs jobs, int *eof,
+                         int pipe_in, int pipe_out) {
+  CommandRep r=command; // cast to CommandRep
+  if (!r->block && !r->flat)
+    child(r,1,pipe_in,pipe_out); // built-in or external command
+  if (pipe_in != -1) { // If there is a pipe input
+    dup2(pipe_in, STDIN_FILENO); // Redirect standard input to pipe input
+    close(pipe_in);
+  }
+  if (pipe_out != -1) { // If there is a pipe output
+    dup2(pipe_out, STDOUT_FILENO); // Redirect standard output to pipe output
+    close(pipe_out);
+  }
+  // This process is already the stage's own, even for { }
+  tailCommand(r, jobs, eof);
+}
+
+// This function runs an external command in place of this process,
+// which has nothing left to do after it: no fork, and no waitpid()
+// The redirections, signal resets and PATH search are those of
+// spawn(), so are its errors; never returns
+//  arguments:
+//   r: CommandRep representing the command to execute
+static void replace(CommandRep r) {
+  signal(SIGTSTP, SIG_DFL); // Restore default handler for SIGTSTP
+  signal(SIGINT, SIG_DFL); // Restore default handler for SIGINT
+  sigset_t none; // and unblock SIGCHLD, held while a pipeline starts
+  sigemptyset(&none);
+  sigprocmask(SIG_SETMASK, &none, 0);
+  int saved[2]; // (close-on-exec)
+  if (!redirect(r,saved))
+    exit(1);
+  fflush(0); // what built-ins wrote before it must not be lost
+  int err=ENOENT;
+  for (int tries=0; err==ENOENT && tries<2; tries++) {
+    char *file=findPath(r->argv[0]);
+    if (!file)
+      break;
+    execv(file,r->argv);
+    if (errno==ENOEXEC) // no #!: run it with /bin/sh
+      execv(_PATH_BSHELL,script(file,r->argv));
+    err=errno;
+    if (err==ENOENT)
+      forgetPath(r->argv[0]);
+  }
+  WARNLOC(__FILE__,__LINE__,"error","%s: %s",r->argv[0],
+          err==ENOENT ? "command not found" : strerror(err));
+  exit(err==ENOENT ? 127 : 126);
+}
+
+// Run a command as the last thing this process does, and exit with
+// its status: an external command is exec'd in place, a built-in runs
+// here, and a block runs here with its own last command in tail
+// position (see tailSequence()); never returns
+// Arguments:
+//   command: the command to run
+//   jobs: the jobs collection
+//   eof: pointer to int indicating end-of-file
+extern void tailCommand(Command command, Jobs jobs, int *eof) {
+  CommandRep r=command; // cast to CommandRep
+  if (r->block || r->flat) { // ( ) needs no process of its own now
+    Sequence seq=newSequence(); // create new Sequence
+    block(r, seq); // interpret the block into Sequence
+    tailSequence(seq, jobs, eof); // execute the sequence
+    exit(0);
+  }
+  if (r->argv && r->argv[0] && !findBuiltin(r))
+    replace(r);
+  int saved[2];
+  status=1;
+  if (redirect(r,saved)) {
+    status=0;
+    builtin(r,eof,jobs,stdout);
+  }
+  exit(status);
+}
+
+// Tell whether a command is a built-in that only writes output, which
+// a pipeline can run on a thread, or in the shell as its last stage
+extern int pureCommand(Command command) {
+  CommandRep r=command; // cast to CommandRep
+  const Builtin *b=r->block || r->flat ? 0 : findBuiltin(r);
+  return b && b->pure;
+}
+
+// Run a pure built-in in this process
+// Returns its exit status
+// Arguments:
+//   command: the built-in to run
+//   jobs: the jobs collection
+//   out: where to write (unless it has a > file), or 0 for stdout,
+//        with the command's redirections swapped in while it runs
+extern int runCommand(Command command, Jobs jobs, FILE *out) {
+  CommandRep r=command; // cast to CommandRep
+  int eof=0; // exit in a pipeline does not end the shell
+  status=0;
+  if (!out) {
+    int saved[2];
+    if (!redirect(r,saved))
+      return 1;
+    builtin(r,&eof,jobs,stdout);
+    restore(saved);
+    return status;
+  }
+  if (r->outfile) { // > takes the output from the pipe
+    FILE *file=fopen(r->outfile,"we");
+    if (!file) {
+      WARNLOC(__FILE__,__LINE__,"error","Failed to open output file");
+      return 1;
+    }
+    builtin(r,&eof,jobs,file);
+    fclose(file);
+    return status;
+  }
+  builtin(r,&eof,jobs,out);
+  return status;
+}
+
+// Drop a "time" word before a command, which its pipeline times
+// Returns 1 if there was one
+// Arguments:
+//   command: The first command of a pipeline
+extern int timedCommand(Command command) {
+  CommandRep r=command;
+  if (!r->argv || !r->argv[0] || strcmp(r->argv[0],"time") || !r->argv[1])
+    return 0;
+  if (!r->packed) // packed strings go with the array
+    free(r->argv[0]);
+  int n=1;
+  while (r->argv[n])
+    n++;
+  memmove(r->argv,r->argv+1,n*sizeof(*r->argv)); // (with the NULL)
+  r->file=r->argv[0];
+  return 1;
+}
+
 // Free a Command
 // Arguments:
 //   command: The command to free
@@ -357,7 +1035,7 @@ extern void freeCommand(Command command) {
   CommandRep r=command; // cast to CommandRep
   if (r->argv) { // if argv is not null
     char **argv=r->argv; // temporary pointer to argv for freeing
-    while (*argv) 
+    while (*argv && !r->packed) // packed strings go with the array
       free(*argv++); // we free each argument string
     free(r->argv);// we free the argv array
   }
@@ -11,19 +11,51 @@
 typedef void *Command;
 
 #include "Tree.h"
+#include "Flat.h"
 #include "Jobs.h"
 #include "Sequence.h"
 #include <sys/types.h> // for pid_t
+#include <stdio.h> // for FILE
 
 // Create a new Command
 extern Command newCommand(T_words words, char *infile, char *outfile);
+// Create a new Command from argc adjacent strings of a flat tree
+extern Command newCommandFlat(char *argv, int argc, char *infile, char *outfile);
 
 // Execute a Command
 extern pid_t execCommand(Command command, Pipeline pipeline, Jobs jobs,
 			int *jobbed, int *eof, int fg, int pipe_in, int pipe_out);
 
+// Launch a pipeline stage without forking, if it is an external command
+// Returns its pid, 0 if it must be forked and run by stageCommand(),
+// or -1 if it could not be launched
+extern pid_t launchCommand(Command command, pid_t pgid,
+                           int pipe_in, int pipe_out);
+// Run a pipeline stage in the process forked for it (never returns)
+extern void stageCommand(Command command, Jobs jobs, int *eof,
+                         int pipe_in, int pipe_out);
+
+// Run a command as the last thing this process does: an external one
+// is exec'd in place of it (never returns)
+extern void tailCommand(Command command, Jobs jobs, int *eof);
+
+// Tell whether a command is a built-in that only writes output
+extern int pureCommand(Command command);
+// Run such a built-in in this process, writing to out (or its > file),
+// or to stdout with its redirections if out is 0; returns its status
+extern int runCommand(Command command, Jobs jobs, FILE *out);
+
+// Drop a "time" word before a command; returns 1 if there was one
+extern int timedCommand(Command command);
+// Launch external commands with posix_spawnp() (on, the default)
+// or with fork() and execvp()
+extern void spawnCommand(int on);
+
 // Free a Command			
 extern void freeCommand(Command command);
+// Set the positional parameters $0, $1, ... of a script or -c
+// (argv[0] is $0); they are substituted in the words of each Command
+extern void paramsCommand(int argc, char **argv);
 // Free state used by built-in commands
 extern void freestateCommand();
 
@@ -0,0 +1,199 @@
+/*
+ * File: flat.c
+ * Description: Implementation of flat.h
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Flat.h"
+#include "Tree.h"
+#include "error.h"
+
+// Representation of a flat tree
+typedef struct F_head *FlatRep;
+
+#define NODES(r) ((struct F_node *)((r)+1))
+#define STRINGS(r) ((char *)(r)+(r)->strings)
+
+// Cursor used while filling in a flat tree
+typedef struct {
+  FlatRep r;
+  int node; // next free node
+  int str;  // next free string byte
+} Fill;
+
+static void count(T_sequence t, int *nodes, int *bytes);
+static int fill(Fill *f, T_sequence t);
+
+// This function counts the nodes and string bytes a command needs
+static void countCommand(T_command t, int *nodes, int *bytes) {
+  (*nodes)++;
+  for (T_words w=t->words; w; w=w->words)
+    *bytes+=strlen(w->word->s)+1;
+  if (t->infile)
+    *bytes+=strlen(t->infile)+1;
+  if (t->outfile)
+    *bytes+=strlen(t->outfile)+1;
+  count(t->block,nodes,bytes);
+}
+
+// This function counts the nodes and string bytes a sequence needs
+static void count(T_sequence t, int *nodes, int *bytes) {
+  for (; t; t=t->sequence) {
+    (*nodes)++;
+    for (T_pipeline p=t->pipeline; p; p=p->pipeline)
+      countCommand(p->command,nodes,bytes);
+  }
+}
+
+// This function copies a string into the string table
+// Returns its offset
+static int putString(Fill *f, char *s) {
+  int off=f->str;
+  int len=strlen(s)+1;
+  memcpy(STRINGS(f->r)+off,s,len);
+  f->str+=len;
+  return off;
+}
+
+// This function fills in the node for a command
+// Returns its index
+static int fillCommand(Fill *f, T_command t) {
+  int i=f->node++;
+  struct F_node *n=NODES(f->r)+i;
+  n->kind=F_COMMAND;
+  n->next=-1;
+  n->argc=0;
+  n->argv=f->str;
+  for (T_words w=t->words; w; w=w->words, n->argc++)
+    putString(f,w->word->s); // words are stored next to each other
+  n->infile=t->infile ? putString(f,t->infile) : -1;
+  n->outfile=t->outfile ? putString(f,t->outfile) : -1;
+  n->subshell=t->subshell;
+  n->block=fill(f,t->block); // n stays valid: the block is preallocated
+  return i;
+}
+
+// This function fills in the nodes for a sequence
+// Returns the index of its first node, -1 if it is empty
+static int fill(Fill *f, T_sequence t) {
+  int first=-1;
+  int *link=&first; // where the next node's index is stored
+  for (; t; t=t->sequence) {
+    int i=f->node++;
+    *link=i;
+    struct F_node *n=NODES(f->r)+i;
+    n->kind=F_SEQUENCE;
+    n->next=-1;
+    n->op=t->op ? *t->op : 0;
+    n->pipeline=-1;
+    int *plink=&n->pipeline;
+    for (T_pipeline p=t->pipeline; p; p=p->pipeline) {
+      int c=fillCommand(f,p->command);
+      *plink=c;
+      plink=&NODES(f->r)[c].next;
+    }
+    link=&n->next;
+  }
+  return first;
+}
+
+// This function converts a linked parse tree into a flat tree
+// The tree is walked twice: once to size the block, once to fill it,
+// so the flat tree costs a single allocation
+extern Flat flattenTree(Tree t) {
+  int nodes=0, bytes=0;
+  count(t,&nodes,&bytes);
+  int strings=sizeof(struct F_head)+nodes*sizeof(struct F_node);
+  FlatRep r=(FlatRep)calloc(1,strings+bytes);
+  if (!r)
+    ERROR("calloc() failed");
+  r->size=strings+bytes;
+  r->nodes=nodes;
+  r->strings=strings;
+  Fill f={r,0,0};
+  r->root=fill(&f,t);
+  return r;
+}
+
+// This function frees a flat tree
+extern void freeFlat(Flat f) {
+  free(f);
+}
+
+// This function gets the size in bytes of a flat tree
+extern int sizeFlat(Flat f) {
+  FlatRep r=(FlatRep)f;
+  return r->size;
+}
+
+// This function gets node i of a flat tree
+extern struct F_node *nodeFlat(Flat f, int i) {
+  FlatRep r=(FlatRep)f;
+  return NODES(r)+i;
+}
+
+// This function gets a string from the string table
+extern char *strFlat(Flat f, int off) {
+  FlatRep r=(FlatRep)f;
+  return STRINGS(r)+off;
+}
+
+// This function gets the index of the first sequence node
+extern int rootFlat(Flat f) {
+  FlatRep r=(FlatRep)f;
+  return r->root;
+}
+
+// This function checks that a node index is in range and of a kind
+static int isNode(FlatRep r, int i, int kind) {
+  return i>=0 && i<r->nodes && NODES(r)[i].kind==kind;
+}
+
+// This function checks that a string offset is in range
+static int isString(FlatRep r, int off) {
+  return off>=0 && off<r->size-r->strings;
+}
+
+// This function checks a flat tree read from outside the shell
+// Links must point forward, as flattenTree() makes them, so a
+// corrupt tree cannot send the interpreter around a cycle
+extern int checkFlat(void *mem, long avail) {
+  FlatRep r=(FlatRep)mem;
+  if (avail<(long)sizeof(*r) || r->size>avail || r->nodes<0 ||
+      r->strings!=(long)sizeof(*r)+(long)r->nodes*(long)sizeof(struct F_node) ||
+      r->strings>r->size)
+    return 0;
+  int bytes=r->size-r->strings;
+  if (bytes && STRINGS(r)[bytes-1]) // every string must end inside
+    return 0;
+  if (r->root!=-1 && !isNode(r,r->root,F_SEQUENCE))
+    return 0;
+  for (int i=0; i<r->nodes; i++) {
+    struct F_node *n=NODES(r)+i;
+    if (n->kind==F_SEQUENCE) {
+      if ((n->next!=-1 && (n->next<=i || !isNode(r,n->next,F_SEQUENCE))) ||
+          n->pipeline<=i || !isNode(r,n->pipeline,F_COMMAND))
+        return 0;
+    } else if (n->kind==F_COMMAND) {
+      if ((n->next!=-1 && (n->next<=i || !isNode(r,n->next,F_COMMAND))) ||
+          (n->block!=-1 && (n->block<=i || !isNode(r,n->block,F_SEQUENCE))) ||
+          (n->infile!=-1 && !isString(r,n->infile)) ||
+          (n->outfile!=-1 && !isString(r,n->outfile)) ||
+          n->argc<0 || (n->argc && !isString(r,n->argv)))
+        return 0;
+      int off=n->argv; // the words must all lie in the table
+      for (int j=0; j<n->argc; j++) {
+        if (!isString(r,off))
+          return 0;
+        off+=strlen(STRINGS(r)+off)+1;
+      }
+    } else
+      return 0;
+  }
+  return 1;
+}
@@ -0,0 +1,64 @@
+/*
+ * File: flat.h
+ * Description: Header file for the flat parse tree: one contiguous
+ * block per line, holding a node array and a string table.
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25 
+ */
+#ifndef FLAT_H
+#define FLAT_H
+
+#include <stdint.h>
+
+#include "Parser.h"
+
+typedef void *Flat;
+
+// Layout of a flat tree, in one block of memory:
+//   struct F_head | struct F_node[nodes] | strings
+// Nodes refer to each other and to strings by index and offset,
+// never by pointer, so the block can be copied or mapped anywhere.
+
+// Header at the start of the block
+struct F_head {
+  int32_t size;    // bytes in the whole block
+  int32_t nodes;   // number of nodes
+  int32_t strings; // offset of the string table from the block start
+  int32_t root;    // index of the first sequence node, -1 if none
+};
+
+// Kinds of node
+enum { F_SEQUENCE, F_COMMAND };
+
+// A sequence element is the first command of a pipeline and its op;
+// a command holds its words as argc adjacent strings starting at argv
+struct F_node {
+  int32_t kind;     // F_SEQUENCE or F_COMMAND
+  int32_t next;     // next node in the same list, -1 at the end
+  int32_t op;       // F_SEQUENCE: '&', ';' or 0
+  int32_t pipeline; // F_SEQUENCE: first F_COMMAND of the pipeline
+  int32_t argc;     // F_COMMAND: number of words, 0 for a block
+  int32_t argv;     // F_COMMAND: string offset of the first word
+  int32_t infile;   // F_COMMAND: string offset, -1 if none
+  int32_t outfile;  // F_COMMAND: string offset, -1 if none
+  int32_t block;    // F_COMMAND: first F_SEQUENCE of ( ) or { }, -1 if none
+  int32_t subshell; // F_COMMAND: 1 for ( ), 0 for { }, -1 otherwise
+};
+
+// Convert a linked parse tree into a newly allocated flat tree
+extern Flat flattenTree(Tree t);
+// Free a flat tree made by flattenTree()
+extern void freeFlat(Flat f);
+// Get the size in bytes of a flat tree
+extern int sizeFlat(Flat f);
+// Get node i of a flat tree
+extern struct F_node *nodeFlat(Flat f, int i);
+// Get the string at offset off of a flat tree's string table
+extern char *strFlat(Flat f, int off);
+// Get the index of the first sequence node, -1 for an empty line
+extern int rootFlat(Flat f);
+// Check that avail bytes at mem hold a well-formed flat tree
+// (for trees read from files, which may be corrupt)
+extern int checkFlat(void *mem, long avail);
+
+#endif
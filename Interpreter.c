@@ -22,6 +22,9 @@ typedef struct {
   char *outfile;
   T_sequence block;
   int subshell;
+  Flat flat; // the block as a flat tree and node index, if flat != 0
+  int fblock;
+  int packed; // 1 if argv and its strings are one allocation
 } *CommandRep;
 
 // Helper functions to interpret components of the parse tree
@@ -58,12 +61,9 @@ static Command i_command(T_command t) {
 //   t: T_pipeline parse tree node
 //   pipeline: Pipeline object to populate
 static void i_pipeline(T_pipeline t, Pipeline pipeline) {
-  if (!t) 
-    return;
-  // We add the command to the pipeline
-  addPipeline(pipeline,i_command(t->command));
-  // We recursively interpret the next pipeline
-  i_pipeline(t->pipeline,pipeline);
+  // We add each command to the pipeline, in order
+  for (; t; t=t->pipeline)
+    addPipeline(pipeline,i_command(t->command));
 }
 
 // Interpret a sequence from the parse tree
@@ -71,19 +71,50 @@ static void i_pipeline(T_pipeline t, Pipeline pipeline) {
 //   t: T_sequence parse tree node
 //   sequence: Sequence object to populate
 void i_sequence(T_sequence t, Sequence sequence) {
-  if (!t)
-    return;
-  int foreground = 1; // default to foreground
-  // check if the last operator is "&"
-  if (t->op && strcmp(t->op, "&") == 0) {
-    foreground = 0; // background job
+  // We interpret each element of the sequence, in order
+  for (; t; t=t->sequence) {
+    int foreground = 1; // default to foreground
+    // check if the last operator is "&"
+    if (t->op && strcmp(t->op, "&") == 0) {
+      foreground = 0; // background job
+    }
+    // Create a new pipeline with the foreground/background setting
+    Pipeline pipeline=newPipeline(foreground);
+    i_pipeline(t->pipeline,pipeline);
+    addSequence(sequence,pipeline); // add the pipeline to the sequence
+  }
+}
+
+// Interpret a command node of a flat parse tree
+static Command i_fcommand(Flat f, struct F_node *n) {
+  char *infile=n->infile<0 ? 0 : strFlat(f,n->infile);
+  char *outfile=n->outfile<0 ? 0 : strFlat(f,n->outfile);
+  // The words are adjacent in the string table, so argv is built
+  // by one pass over them
+  Command command=newCommandFlat(strFlat(f,n->argv),n->argc,infile,outfile);
+  CommandRep r=(CommandRep)command;
+  if (n->block>=0) { // ( ) or { } refers back into the flat tree
+    r->flat=f;
+    r->fblock=n->block;
+  }
+  r->subshell=n->subshell;
+  return command;
+}
+
+// Interpret a sequence of a flat parse tree
+// Arguments:
+//   f: the flat parse tree
+//   seq: index of the first F_SEQUENCE node, -1 if empty
+//   sequence: Sequence object to populate
+extern void i_flat(Flat f, int seq, Sequence sequence) {
+  while (seq>=0) {
+    struct F_node *n=nodeFlat(f,seq);
+    Pipeline pipeline=newPipeline(n->op!='&'); // "&" makes a background job
+    for (int c=n->pipeline; c>=0; c=nodeFlat(f,c)->next)
+      addPipeline(pipeline,i_fcommand(f,nodeFlat(f,c)));
+    addSequence(sequence,pipeline); // add the pipeline to the sequence
+    seq=n->next;
   }
-  // Create a new pipeline with the foreground/background setting
-  Pipeline pipeline=newPipeline(foreground);
-  i_pipeline(t->pipeline,pipeline);
-  addSequence(sequence,pipeline); // add the pipeline to the sequence
-  // Recursively interpret the next sequence 
-  i_sequence(t->sequence,sequence);
 }
 
 // Interpret the parse tree into executable objects
@@ -98,3 +129,26 @@ extern void interpretTree(Tree t, int *eof, Jobs jobs) {
   i_sequence(t,sequence); // interpret the T_sequence into Sequence
   execSequence(sequence,jobs,eof); // execute the sequence
 }
+
+// Interpret the flat parse tree into executable objects
+// Arguments:
+//   f: The flat parse tree
+//   eof: pointer to int indicating end-of-file
+//   jobs: The jobs collection
+extern void interpretFlat(Flat f, int *eof, Jobs jobs) {
+  if (!f || rootFlat(f)<0)
+    return;
+  Sequence sequence=newSequence(); // create a new sequence
+  i_flat(f,rootFlat(f),sequence); // interpret the flat tree into Sequence
+  execSequence(sequence,jobs,eof); // execute the sequence
+}
+
+// Interpret a flat parse tree as the last thing this process does:
+// its last command runs in place of the process (see tailSequence())
+extern void tailFlat(Flat f, int *eof, Jobs jobs) {
+  if (!f || rootFlat(f)<0)
+    return;
+  Sequence sequence=newSequence(); // create a new sequence
+  i_flat(f,rootFlat(f),sequence); // interpret the flat tree into Sequence
+  tailSequence(sequence,jobs,eof); // execute the sequence
+}
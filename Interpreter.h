@@ -9,11 +9,19 @@
 
 #include "Parser.h"
 #include "Tree.h"
+#include "Flat.h"
 #include "Jobs.h"
 
 // Interpret the parse tree into executable objects
 extern void interpretTree(Tree t, int *eof, Jobs jobs);
 // Interpret a sequence from the parse tree
 extern void i_sequence(T_sequence t, Sequence sequence);
+// Interpret the flat parse tree into executable objects
+extern void interpretFlat(Flat f, int *eof, Jobs jobs);
+// Interpret it as the last thing this process does (a lone last
+// command is exec'd in place of the process)
+extern void tailFlat(Flat f, int *eof, Jobs jobs);
+// Interpret the sequence starting at node seq of a flat parse tree
+extern void i_flat(Flat f, int seq, Sequence sequence);
 
 #endif
@@ -5,125 +5,728 @@
  * Date: 10/18/25 
  */
 
+#define _GNU_SOURCE // for pipe2()
  #include "Jobs.h"
-#include "deq.h"
 #include "error.h"
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
 #include <sys/wait.h>
+#include <sys/pidfd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <signal.h>
 #include <stdio.h>
 
+// The state of a process, or of a job as a whole
+enum { RUNNING, STOPPED, DONE };
+
+typedef struct Job *Job;
+
+// We create a Proc structure for each process of a job; it is also
+// the entry for its pid in the table of live processes
+typedef struct Proc {
+  struct Proc *chain; // next entry in the same hash bucket
+  pid_t pid;
+  int state; // RUNNING, STOPPED or DONE
+  int status; // wait status, once DONE
+  int pidfd; // readable when it exits, once wait has opened it, or -1
+  struct rusage ru; // its resource usage, once DONE
+  struct timespec end; // when it was reaped, once DONE
+  Job job;
+} *Proc;
+
 // We create a Job structure to hold information about each job
-typedef struct {
+struct Job {
   int job_id; // unique job ID
-  pid_t *pids; // array of process IDs in the job
+  Proc procs; // array of the job's processes
   int num_pids; // number of processes
   Pipeline pipeline; // the associated pipeline
-  int stopped; // 1 if stopped, 0 if running
-} *Job;
+  int live; // processes not DONE
+  int stopped; // processes STOPPED
+  int status; // wait status of the last process, once all are DONE
+  int fg; // 1 while the shell waits for it in the foreground
+  struct timespec start; // when it was added, as it was launched
+  Job prev, next; // the jobs, in the order they were added
+  Job chain; // next job in the same hash bucket
+};
+
+// A process reaped before its job knew its pid, and how it ended
+typedef struct {
+  pid_t pid;
+  int status;
+  struct rusage ru;
+} Early;
+#define NEARLY 16
+
+// We keep the jobs in order, with hash tables of the jobs by ID and of
+// their live processes by pid
+typedef struct {
+  Job head, tail; // oldest and newest job
+  int count; // number of jobs
+  Job *ids; // jobs by ID
+  int nids;
+  Proc *buckets; // live processes by pid
+  int nbuckets;
+  int entries;
+  int done; // jobs DONE but not yet reported
+  int limit; // most jobs DONE to keep
+  Early early[NEARLY]; // (the oldest is overwritten)
+  int nearly;
+} *JobsRep;
 
 static int next_job_id = 1; // To assign unique job IDs
 
+// SIGCHLD writes a byte to this pipe, so reaping is only tried when a
+// child has changed state; the handler does nothing else
+static int note[2] = {-1, -1};
+static pid_t owner; // the process the pipe is for
+
 // free job declaration
 static void freeJob(Job job);
 
 // Create a new empty Jobs collection
 extern Jobs newJobs() {
-  //Deque to store jobs
-  return deq_new();
+  JobsRep r=malloc(sizeof(*r)); // we allocate the jobs and their table
+  if (!r)
+    ERROR("malloc() failed");
+  r->head=r->tail=0; // no jobs yet
+  r->count=0;
+  r->ids=0;
+  r->nids=0;
+  r->buckets=0;
+  r->nbuckets=0;
+  r->entries=0;
+  r->done=0;
+  r->limit=100;
+  r->nearly=0;
+  if (owner!=getpid()) { // (a subshell gets its own)
+    if (note[0]!=-1) {
+      close(note[0]);
+      close(note[1]);
+    }
+    if (pipe2(note,O_CLOEXEC|O_NONBLOCK))
+      ERROR("pipe2() failed");
+    owner=getpid();
+  }
+  return r;
+}
+
+// This function notes a SIGCHLD for reapJobs(); it is safe in a handler
+extern void noteJobs() {
+  int saved=errno;
+  if (note[1]!=-1)
+    write(note[1],"",1); // (if the pipe is full, a byte is there anyway)
+  errno=saved;
+}
+
+// This function doubles the hash table of live processes
+static void grow(JobsRep r) {
+  int n=r->nbuckets ? 2*r->nbuckets : 64;
+  Proc *b=calloc(n,sizeof(*b));
+  if (!b)
+    ERROR("calloc() failed");
+  for (int i=0; i<r->nbuckets; i++)
+    while (r->buckets[i]) {
+      Proc p=r->buckets[i];
+      r->buckets[i]=p->chain;
+      p->chain=b[p->pid&(n-1)];
+      b[p->pid&(n-1)]=p;
+    }
+  free(r->buckets);
+  r->buckets=b;
+  r->nbuckets=n;
+}
+
+// This function finds the bucket link to the entry for a pid
+static Proc *find(JobsRep r, pid_t pid) {
+  if (!r->nbuckets)
+    grow(r);
+  Proc *p=&r->buckets[pid&(r->nbuckets-1)];
+  while (*p && (*p)->pid!=pid)
+    p=&(*p)->chain;
+  return p;
+}
+
+// This function doubles the hash table of jobs by ID
+static void growIds(JobsRep r) {
+  int n=r->nids ? 2*r->nids : 64;
+  Job *b=calloc(n,sizeof(*b));
+  if (!b)
+    ERROR("calloc() failed");
+  for (int i=0; i<r->nids; i++)
+    while (r->ids[i]) {
+      Job job=r->ids[i];
+      r->ids[i]=job->chain;
+      job->chain=b[job->job_id&(n-1)];
+      b[job->job_id&(n-1)]=job;
+    }
+  free(r->ids);
+  r->ids=b;
+  r->nids=n;
+}
+
+// This function finds the bucket link to the entry for a job ID
+static Job *findId(JobsRep r, int job_id) {
+  if (!r->nids)
+    growIds(r);
+  Job *j=&r->ids[job_id&(r->nids-1)];
+  while (*j && (*j)->job_id!=job_id)
+    j=&(*j)->chain;
+  return j;
+}
+
+// This function finds a job by its ID
+static Job findJob(JobsRep r, int job_id) {
+  return *findId(r, job_id);
+}
+
+// This function updates a process, and its job, with a wait status and
+// the resource usage reaped with it (0 if unknown): O(1), whichever job
+// it is in
+static void update(JobsRep r, Proc p, int status, struct rusage *ru) {
+  Job job=p->job;
+  if (WIFSTOPPED(status)) {
+    if (p->state==RUNNING) {
+      p->state=STOPPED;
+      job->stopped++;
+    }
+    return;
+  }
+  if (WIFCONTINUED(status)) {
+    if (p->state==STOPPED) {
+      p->state=RUNNING;
+      job->stopped--;
+    }
+    return;
+  }
+  if (p->state==DONE)
+    return;
+  if (p->state==STOPPED)
+    job->stopped--;
+  p->state=DONE;
+  p->status=status;
+  if (ru)
+    p->ru=*ru;
+  clock_gettime(CLOCK_MONOTONIC,&p->end);
+  if (p->pidfd!=-1) {
+    close(p->pidfd);
+    p->pidfd=-1;
+  }
+  Proc *link=find(r,p->pid); // its pid may be reused now
+  if (*link==p) {
+    *link=p->chain;
+    r->entries--;
+  }
+  if (p==&job->procs[job->num_pids-1])
+    job->status=status; // a pipeline's status is its last command's
+  if (!--job->live && !job->fg)
+    r->done++;
+}
+
+// This function takes a wait status for a pid, from any job
+static void reaped(JobsRep r, pid_t pid, int status, struct rusage *ru) {
+  Proc p=*find(r,pid);
+  if (p)
+    update(r,p,status,ru);
+  else if (!WIFSTOPPED(status) && !WIFCONTINUED(status)) {
+    // (its job is being launched, or it is no job's)
+    r->early[r->nearly%NEARLY]=(Early){pid,status,*ru};
+    r->nearly++;
+  }
 }
 
 // Add a Pipeline to the Jobs collection
+// Returns the new job's ID
 // arguments:
 //   jobs: The Jobs collection
 //   pipeline: The Pipeline to add as a new job
-extern void addJobs(Jobs jobs, Pipeline pipeline) {
+extern int addJobs(Jobs jobs, Pipeline pipeline) {
+  JobsRep r=jobs;
   Job job=malloc(sizeof(*job));// we allocate memory for a new job
   if (!job)// check for malloc failure
     ERROR("malloc() failed");
   job->job_id=next_job_id++; // assign a unique job ID
-  job->pids=NULL; // we start with no process IDs
+  job->procs=NULL; // we start with no process IDs
   job->num_pids=0; // we start with zero processes
   job->pipeline=pipeline; // we associate the pipeline
+  job->live=0;
   job->stopped=0; // job starts running, not stopped
-  // Add the job to the jobs deque
-  deq_tail_put(jobs,job);
+  job->status=0;
+  job->fg=0;
+  clock_gettime(CLOCK_MONOTONIC,&job->start);
+  // Add the job after the others, and to the table
+  job->prev=r->tail;
+  job->next=0;
+  if (r->tail)
+    r->tail->next=job;
+  else
+    r->head=job;
+  r->tail=job;
+  r->count++;
+  if (2*r->count >= r->nids)
+    growIds(r);
+  Job *link=findId(r,job->job_id);
+  job->chain=*link;
+  *link=job;
+  return job->job_id;
 }
 
 // Return the number of Pipelines in the Jobs collection
 extern int sizeJobs(Jobs jobs) {
-  return deq_len(jobs);
+  JobsRep r=jobs;
+  return r->count;
+}
+
+// This function retires a job: it leaves the collection and is freed
+static void retire(JobsRep r, Job job) {
+  if (!job->live && !job->fg && job->num_pids)
+    r->done--;
+  for (int i=0; i<job->num_pids; i++)
+    if (job->procs[i].state!=DONE) { // (it is no longer watched)
+      Proc *link=find(r,job->procs[i].pid);
+      if (*link==&job->procs[i]) {
+        *link=job->procs[i].chain;
+        r->entries--;
+      }
+    }
+  *findId(r,job->job_id)=job->chain; // it leaves the table
+  if (job->prev) // and the order
+    job->prev->next=job->next;
+  else
+    r->head=job->next;
+  if (job->next)
+    job->next->prev=job->prev;
+  else
+    r->tail=job->prev;
+  r->count--;
+  freeJob(job);
+}
+
+// This function retires the oldest DONE jobs beyond the limit, even
+// if they have not been reported
+static void bound(JobsRep r) {
+  for (Job job=r->head, next; r->done>r->limit && job; job=next) {
+    next=job->next;
+    if (job->num_pids && !job->live && !job->fg)
+      retire(r,job);
+  }
+}
+
+// This function reaps every child that has changed state since the
+// last SIGCHLD was noted, and updates their jobs
+// arguments:
+//   jobs: The Jobs collection
+extern void reapJobs(Jobs jobs) {
+  JobsRep r=jobs;
+  char buf[64];
+  int noted=0;
+  while (read(note[0],buf,sizeof(buf))>0)
+    noted=1;
+  if (!noted)
+    return; // nothing has happened
+  int status;
+  struct rusage ru;
+  pid_t pid;
+  while ((pid=wait4(-1,&status,WNOHANG|WUNTRACED|WCONTINUED,&ru))>0)
+    reaped(r,pid,status,&ru);
+  bound(r);
 }
 
-// Set the process IDs for the jobs
+// Set the process IDs for a job
 // arguments:
 //   jobs: The Jobs collection
+//   job_id: The ID of the job, from addJobs()
 //   pids: Array of process IDs to set
 //   num_pids: Number of process IDs in the array
-extern void setJobPids(Jobs jobs, pid_t *pids, int num_pids){
-  if (deq_len(jobs) == 0)
-    return; // No jobs to set PIDs for
-  
-  // Get the job it was added last
-  Job job = deq_tail_ith(jobs,0); 
-  
+extern void setJobPids(Jobs jobs, int job_id, pid_t *pids, int num_pids){
+  JobsRep r=jobs;
+  Job job = findJob(r, job_id);
+  if (!job || job->procs)
+    return; // No such job, or its PIDs are set already
+
   // Allocate memory for the PIDs
-  job->pids = malloc(sizeof(pid_t) * num_pids);
-  if (!job->pids)
+  job->procs = malloc(sizeof(*job->procs) * num_pids);
+  if (!job->procs)
     ERROR("malloc() failed");
 
-  // We copy the PIDs into the job structure
+  // We copy the PIDs into the job structure, and the table
+  job->num_pids = num_pids;
+  job->live = num_pids;
   for (int i = 0; i < num_pids; i++) {
-    job->pids[i] = pids[i];
+    Proc p = &job->procs[i];
+    p->pid = pids[i];
+    p->state = RUNNING;
+    p->status = 0;
+    p->pidfd = -1;
+    p->ru = (struct rusage){{0}};
+    p->job = job;
+    if (2*r->entries >= r->nbuckets)
+      grow(r);
+    Proc *link = find(r, p->pid);
+    p->chain = *link;
+    *link = p;
+    r->entries++;
   }
-  // We set the number of PIDs
-  job->num_pids = num_pids;
+  // Some may have been reaped already
+  for (int i = 0; i < NEARLY && i < r->nearly; i++) {
+    Early *e = &r->early[i];
+    Proc p = e->pid ? *find(r, e->pid) : 0;
+    if (p && p->job == job) {
+      update(r, p, e->status, &e->ru);
+      e->pid = 0;
+    }
+  }
+  reapJobs(jobs); // now that none of its processes can be missed
+}
+
+// This function writes a job's line: its state, or how it ended
+static void line(Job job, FILE *out) {
+  if (job->num_pids == 0) // If the job has no PIDs
+    fprintf(out,"[%d] Running (no PIDs)\n", job->job_id);
+  else if (job->live == 0) { // How the last process ended
+    int s = job->status;
+    if (WIFSIGNALED(s))
+      fprintf(out,"[%d] %s\n", job->job_id, strsignal(WTERMSIG(s)));
+    else if (WEXITSTATUS(s))
+      fprintf(out,"[%d] Exit %d\n", job->job_id, WEXITSTATUS(s));
+    else
+      fprintf(out,"[%d] Done\n", job->job_id);
+  } else if (job->stopped) // print stopped status
+    fprintf(out,"[%d] Stopped\n", job->job_id);
+  else // print running status
+    fprintf(out,"[%d] Running\n", job->job_id);
+}
+
+// This function adds a process's resource usage to a total: times,
+// faults and context switches add up, and the peak RSS is the largest
+static void add(struct rusage *sum, struct rusage *ru) {
+  timeradd(&sum->ru_utime, &ru->ru_utime, &sum->ru_utime);
+  timeradd(&sum->ru_stime, &ru->ru_stime, &sum->ru_stime);
+  if (ru->ru_maxrss > sum->ru_maxrss)
+    sum->ru_maxrss = ru->ru_maxrss;
+  sum->ru_majflt += ru->ru_majflt;
+  sum->ru_nvcsw += ru->ru_nvcsw;
+  sum->ru_nivcsw += ru->ru_nivcsw;
+}
+
+// This function gives the resource usage of a process: as reaped, or
+// so far, from /proc, if it has not ended
+static void usage(Proc p, struct rusage *ru) {
+  if (p->state == DONE) {
+    *ru = p->ru;
+    return;
+  }
+  *ru = (struct rusage){{0}};
+  char path[64], buf[1024];
+  snprintf(path, sizeof(path), "/proc/%d/stat", p->pid);
+  FILE *f = fopen(path, "re");
+  if (f) {
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[n] = 0;
+    fclose(f);
+    char *s = strrchr(buf, ')'); // (after the command's name)
+    unsigned long majflt, utime, stime; // (utime and stime in ticks)
+    if (s && sscanf(s + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %lu %*u "
+                    "%lu %lu", &majflt, &utime, &stime) == 3) {
+      long hz = sysconf(_SC_CLK_TCK);
+      ru->ru_utime = (struct timeval){utime / hz, utime % hz * 1000000 / hz};
+      ru->ru_stime = (struct timeval){stime / hz, stime % hz * 1000000 / hz};
+      ru->ru_majflt = majflt;
+    }
+  }
+  snprintf(path, sizeof(path), "/proc/%d/status", p->pid);
+  if ((f = fopen(path, "re"))) {
+    while (fgets(buf, sizeof(buf), f))
+      if (sscanf(buf, "VmHWM: %ld", &ru->ru_maxrss) != 1 &&
+          sscanf(buf, "voluntary_ctxt_switches: %ld", &ru->ru_nvcsw) != 1)
+        sscanf(buf, "nonvoluntary_ctxt_switches: %ld", &ru->ru_nivcsw);
+    fclose(f);
+  }
+}
+
+// This function gives the seconds from a job's launch to a process's
+// end, or to now if it has not ended
+static double elapsed(Job job, Proc p) {
+  struct timespec end = p ? p->end : (struct timespec){0};
+  if (!p || p->state != DONE)
+    clock_gettime(CLOCK_MONOTONIC, &end);
+  return end.tv_sec - job->start.tv_sec +
+         (end.tv_nsec - job->start.tv_nsec) / 1e9;
+}
+
+// Write resource usage: wall-clock (real) and CPU times, peak RSS,
+// major faults and voluntary/involuntary context switches
+extern void usageJobs(FILE *out, struct rusage *ru, double real) {
+  fprintf(out, "real %.3fs user %.3fs sys %.3fs maxrss %ldKB majflt %ld "
+          "csw %ld/%ld\n", real,
+          ru->ru_utime.tv_sec + ru->ru_utime.tv_usec / 1e6,
+          ru->ru_stime.tv_sec + ru->ru_stime.tv_usec / 1e6,
+          ru->ru_maxrss, ru->ru_majflt, ru->ru_nvcsw, ru->ru_nivcsw);
+}
+
+// This function writes the usage of each process of a job, and of the
+// job, if it has several
+static void stats(Job job, FILE *out) {
+  struct rusage sum = {{0}}, ru;
+  double real = 0;
+  for (int i = 0; i < job->num_pids; i++) {
+    Proc p = &job->procs[i];
+    usage(p, &ru);
+    add(&sum, &ru);
+    double t = elapsed(job, p);
+    if (t > real)
+      real = t;
+    fprintf(out, "    %d %s ", p->pid,
+            p->state == DONE ? "Done" : p->state == STOPPED ? "Stopped"
+            : "Running");
+    usageJobs(out, &ru, t);
+  }
+  if (job->num_pids > 1) {
+    fprintf(out, "    total ");
+    usageJobs(out, &sum, real);
+  }
+}
+
+// Print the list of jobs with their statuses, and with their processes'
+// resource usage if long; the ones that have ended are reported this
+// once, and retired
+extern void printJobs(Jobs jobs, FILE *out, int lng) {
+  JobsRep r=jobs;
+  reapJobs(jobs);
+  // we go through each job, in order
+  for (Job job = r->head, next; job; job = next) {
+    next = job->next; // (it may be retired)
+    line(job, out);
+    if (lng)
+      stats(job, out);
+    if (job->num_pids && !job->live) // reported: retire it
+      retire(r, job);
+  }
+}
+
+// This function reports the jobs that have ended since the last time,
+// and retires them (before an interactive prompt)
+extern void reportJobs(Jobs jobs, FILE *out) {
+  JobsRep r=jobs;
+  reapJobs(jobs);
+  for (Job job = r->head, next; r->done && job; job = next) {
+    next = job->next;
+    if (job->num_pids && !job->live && !job->fg) {
+      line(job, out);
+      retire(r, job);
+    }
+  }
+  fflush(out);
+}
+
+// This function bounds the jobs that have ended and are kept until
+// reported; beyond it, the oldest are retired
+extern void limitJobs(Jobs jobs, int limit) {
+  JobsRep r=jobs;
+  r->limit = limit < 0 ? 0 : limit;
+  bound(r);
+}
+
+// This function turns a wait status into an exit status, as $? would be
+static int exitStatus(int s) {
+  if (WIFSIGNALED(s))
+    return 128 + WTERMSIG(s);
+  return WEXITSTATUS(s);
+}
+
+// This function waits in the foreground until a job ends or stops,
+// updating any job whose processes change state meanwhile; a job that
+// ends is reported by this, and retired
+// Returns its exit status, or -1 if there is no such job
+// arguments:
+//   jobs: The Jobs collection
+//   job_id: The ID of the job to wait for
+//   ru: The job's resource usage is added to it, unless it is 0
+extern int waitJob(Jobs jobs, int job_id, struct rusage *ru) {
+  JobsRep r=jobs;
+  Job job = findJob(r, job_id);
+  if (!job)
+    return -1;
+  if (!job->live && job->num_pids) // it had ended already
+    r->done--;
+  job->fg = 1;
+  while (job->live && !job->stopped) {
+    int status;
+    struct rusage ru;
+    // WUNTRACED allows us to detect if the process was stopped
+    pid_t pid = wait4(-1, &status, WUNTRACED | WCONTINUED, &ru);
+    if (pid > 0)
+      reaped(r, pid, status, &ru);
+    else if (errno == ECHILD) { // (reaped by someone else: gone)
+      for (int i = 0; i < job->num_pids; i++)
+        if (job->procs[i].state != DONE)
+          update(r, &job->procs[i], 0, 0);
+    }
+  }
+  for (int i = 0; ru && i < job->num_pids; i++) {
+    struct rusage p;
+    usage(&job->procs[i], &p);
+    add(ru, &p);
+  }
+  if (job->stopped) { // it stops in the background
+    job->fg = 0;
+    printf("\n");
+    return 128 + SIGTSTP;
+  }
+  int status = exitStatus(job->status);
+  retire(r, job); // (as it is reported here)
+  bound(r);
+  return status;
+}
+
+// This function tells if wait waits for a job: a running one, in the
+// background
+static int awaited(Job job) {
+  return job->num_pids && job->live && !job->stopped && !job->fg;
+}
+
+// This function collects the exit of a process whose pidfd is readable
+static void collect(JobsRep r, Proc p) {
+  siginfo_t si;
+  struct rusage ru;
+  si.si_pid = 0;
+  // (the system call, unlike waitid(), gives the usage too)
+  if (syscall(SYS_waitid, P_PIDFD, p->pidfd, &si, WEXITED | WNOHANG, &ru)
+      || !si.si_pid)
+    return; // (reaped already, by reapJobs())
+  if (si.si_code == CLD_EXITED)
+    update(r, p, W_EXITCODE(si.si_status, 0), &ru);
+  else // killed, or dumped core
+    update(r, p, si.si_status, &ru);
 }
-// Print the list of jobs with their statuses
-extern void printJobs(Jobs jobs) {
-  int i = 0;
-  // we go through each job in the jobs deque
-  while (i < deq_len(jobs)) {
-    // Get the job at index i
-    Job job = deq_head_ith(jobs, i);
-    // If the job has no PIDs, we print a message and continue
-    if (job->pids == NULL) {
-      printf("[%d] Running (no PIDs)\n", job->job_id);
-      i++;
-      continue;
-    }
-    
-    // Check if all processes are done
-    int all_done = 1;
-    // We check each PID in the job
-    for (int j = 0; j < job->num_pids; j++) {
-      int status;
-      // We use waitpid to check the status of each PID
-      pid_t result = waitpid(job->pids[j], &status, WNOHANG);
-      if (result == 0) {  // Still running
-        all_done = 0;  // Mark as not done
-        break; 
+
+// This function waits for background jobs to end, as the wait built-in
+// does: each running process's pidfd is polled, with the SIGCHLD pipe
+// for the rest (stops, and kernels without pidfds)
+// Returns the exit status, 127 if there is no job to wait for, or 124
+// on a timeout
+// arguments:
+//   jobs: The Jobs collection
+//   ids: The IDs of the jobs to wait for, or 0 for every job
+//   n: The number of IDs
+//   any: 1 to wait for whichever job ends first
+//   timeout: The most milliseconds to wait, or -1 for no limit
+//   which: Set to the ID of the job that ended, for any, unless it is 0
+extern int waitJobs(Jobs jobs, int *ids, int n, int any, int timeout,
+                    int *which) {
+  JobsRep r=jobs;
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  long end = t.tv_sec * 1000L + t.tv_nsec / 1000000 + timeout;
+  int size = 64;
+  struct pollfd *fds = malloc(size * sizeof(*fds));
+  Proc *procs = malloc(size * sizeof(*procs)); // the process of each pidfd
+  if (!fds || !procs)
+    ERROR("malloc() failed");
+  int status = 127;
+  if (which)
+    *which = 0;
+  reapJobs(jobs);
+  for (;;) {
+    // The jobs waited for, in order: the ones listed, or all
+    int k = 0; // (the listed ones are at most n, looked up each time)
+    Job job = ids ? 0 : r->head;
+    Job ended = 0; // for any, the oldest job that has ended
+    int waiting = 0; // any job left to wait for?
+    int m = 1; // the SIGCHLD pipe, then the pidfds
+    for (;; job = job->next) {
+      if (ids)
+        for (job = 0; !job && k < n; k++)
+          job = findJob(r, ids[k]);
+      if (!job)
+        break;
+      if (any && !ended && job->num_pids && !job->live && !job->fg)
+        ended = job;
+      if (!awaited(job))
+        continue;
+      waiting = 1;
+      for (int i = 0; i < job->num_pids; i++) {
+        Proc p = &job->procs[i];
+        if (p->state != RUNNING)
+          continue;
+        if (p->pidfd == -1)
+          p->pidfd = pidfd_open(p->pid, 0); // (-1 without pidfds)
+        if (p->pidfd == -1)
+          continue;
+        if (m == size) {
+          size *= 2;
+          fds = realloc(fds, size * sizeof(*fds));
+          procs = realloc(procs, size * sizeof(*procs));
+          if (!fds || !procs)
+            ERROR("realloc() failed");
+        }
+        fds[m] = (struct pollfd){p->pidfd, POLLIN, 0};
+        procs[m++] = p;
       }
     }
-    
-    // If all processes are done, we remove the job
-    if (all_done) {
-      // Remove finished job
-      deq_head_rem(jobs, job);
-      freeJob(job);
-    } else {
-      // Print status
-      if (job->stopped) {
-        // print stopped status
-        printf("[%d] Stopped\n", job->job_id);
-      } else {
-        // print running status
-        printf("[%d] Running\n", job->job_id);
+    if (ended) { // it is reported here, and retired
+      status = exitStatus(ended->status);
+      if (which)
+        *which = ended->job_id;
+      retire(r, ended);
+      break;
+    }
+    if (!waiting) {
+      if (any || !ids) {
+        status = any ? 127 : 0;
+        break;
       }
-      // Move to next job
-      i++;
+      // The listed jobs have ended or stopped: the status is the last
+      // one's, and the ones that ended are reported here
+      for (int i = 0; i < n; i++) {
+        Job job = findJob(r, ids[i]);
+        status = !job ? 127 : job->stopped ? 128 + SIGTSTP
+                 : exitStatus(job->status);
+        if (job && !job->live && job->num_pids)
+          retire(r, job);
+      }
+      break;
+    }
+    fds[0] = (struct pollfd){note[0], POLLIN, 0};
+    int ms = -1;
+    if (timeout >= 0) {
+      clock_gettime(CLOCK_MONOTONIC, &t);
+      ms = end - (t.tv_sec * 1000L + t.tv_nsec / 1000000);
+      if (ms < 0)
+        ms = 0;
     }
+    int ready = poll(fds, m, ms);
+    if (ready == 0) {
+      status = 124;
+      break;
+    }
+    for (int i = 1; ready > 0 && i < m; i++)
+      if (fds[i].revents)
+        collect(r, procs[i]);
+    if (fds[0].revents)
+      reapJobs(jobs);
   }
+  free(fds);
+  free(procs);
+  bound(r);
+  return status;
+}
+
+// This function continues the stopped processes of a job
+static void resume(Job job) {
+  for (int j = 0; j < job->num_pids; j++)
+    if (job->procs[j].state == STOPPED) {
+      // SIGCONT is used to continue a stopped process
+      kill(job->procs[j].pid, SIGCONT);
+      job->procs[j].state = RUNNING;
+      job->stopped--;
+    }
 }
 
 // This function brings a job to the foreground
@@ -131,43 +734,22 @@ extern void printJobs(Jobs jobs) {
 //   jobs: The Jobs collection
 //   job_id: The ID of the job to bring to foreground
 extern void foregroundJob(Jobs jobs, int job_id) {
+  JobsRep r=jobs;
+  reapJobs(jobs);
   // We search for the job with the given job_id
-  for (int i = 0; i < deq_len(jobs); i++) {
-    Job job = deq_head_ith(jobs,i); // get the job at index i
-    if (job->job_id == job_id) { // if we find the job
-      if (job->pids == NULL) {
-        ERROR("Job has no PIDs");
-        return;
-      }
-      // If stopped, we send SIGCONT to resume it
-      // SIGCONT helps us to continue a stopped process
-      if (job->stopped) {
-        // We resume each PID in the job
-        for (int j = 0; j < job->num_pids; j++) {
-          // We send the signal to the process
-          kill(job->pids[j], SIGCONT); 
-        }
-        job->stopped = 0; // mark as running
-      }
-      // We wait for all processes in the job to finish
-      for (int j = 0; j < job->num_pids; j++) {
-        int status;
-        // We wait for each PID
-        // WUNTRACED allows us to detect if the process was stopped
-        waitpid(job->pids[j], &status, WUNTRACED);
-        
-        // Check if stopped again
-        // WIFSTOPPED returns true if the process is stopped
-        if (WIFSTOPPED(status)) {
-          job->stopped = 1;
-          printf("\n");
-        }
-      }
-      return;
-    }
+  Job job = findJob(r, job_id);
+  if (!job) { // If we don't find the job, we print an error message
+    fprintf(stderr, "fg: job %d not found\n", job_id);
+    return;
+  }
+  if (job->num_pids == 0) {
+    ERROR("Job has no PIDs");
+    return;
   }
-  // If we don't find the job, we print an error message
-  fprintf(stderr, "fg: job %d not found\n", job_id);
+  // If stopped, we send SIGCONT to resume it
+  resume(job);
+  // We wait for all processes in the job to finish
+  waitJob(jobs, job_id, 0);
 }
 
 // Send a job to the background
@@ -175,52 +757,42 @@ extern void foregroundJob(Jobs jobs, int job_id) {
 //   jobs: The Jobs collection
 //   job_id: The ID of the job to send to background
 extern void backgroundJob(Jobs jobs, int job_id) {
+  JobsRep r=jobs;
+  reapJobs(jobs);
   // We search for the job with the given job_id
-  for (int i = 0; i < deq_len(jobs); i++) {
-    Job job = deq_head_ith(jobs,i); // get the job at index i
-    if (job->job_id == job_id) { // if we find the job
-      if (job->pids == NULL) { // if the job has no PIDs we print an error
-        ERROR("Job has no PIDs");
-        return;
-      }
-
-      // We resume stopped job
-      if (job->stopped) {
-        for (int j = 0; j < job->num_pids; j++) {
-          // SIGCONT is used to continue a stopped process
-          kill(job->pids[j], SIGCONT); 
-        }
-        job->stopped = 0; // mark as running
-      }
-      return; // We return after sending the job to background
-    }
+  Job job = findJob(r, job_id);
+  if (!job) { // If we don't find the job, we print an error message
+    fprintf(stderr, "bg: job %d not found\n", job_id);
+    return;
   }
-  // If we don't find the job, we print an error message
-  fprintf(stderr, "bg: job %d not found\n", job_id);
-}
-
-// Mark the most recent job as stopped
-extern void markJobStopped(Jobs jobs) {
-  if (deq_len(jobs) == 0)
+  if (job->num_pids == 0) { // if the job has no PIDs we print an error
+    ERROR("Job has no PIDs");
     return;
-
-  // We get the most recent job
-  Job job = deq_tail_ith(jobs, 0);
-  // We mark it as stopped
-  job->stopped = 1;
+  }
+  // We resume stopped job
+  resume(job);
 }
 
 // This function frees the Jobs collection and all its Pipelines
 static void freeJob(Job job) {
-  if (job->pids) // we free the PIDs array if it exists
-    free(job->pids);
+  for (int i = 0; i < job->num_pids; i++)
+    if (job->procs[i].pidfd != -1)
+      close(job->procs[i].pidfd);
+  if (job->procs) // we free the PIDs array if it exists
+    free(job->procs);
   freePipeline(job->pipeline); // we free the associated pipeline
   free(job); // we free the job structure itself
 }
 
 // Free the Jobs collection and all its Pipelines
 extern void freeJobs(Jobs jobs) {
-  // We use deq_del to free each job using freeJob
-  // We use deqMapF to cast freeJob to the correct function pointer type
-  deq_del(jobs, (DeqMapF)freeJob);
+  JobsRep r=jobs;
+  // We free each job, with its pipeline
+  for (Job job = r->head, next; job; job = next) {
+    next = job->next;
+    freeJob(job);
+  }
+  free(r->ids);
+  free(r->buckets);
+  free(r);
 }
@@ -12,25 +12,47 @@ typedef void *Jobs;
 
 #include "Pipeline.h"
 #include <sys/types.h> // for pid_t
+#include <stdio.h> // for FILE
+#include <sys/resource.h> // for struct rusage
 
 // Create a new empty Jobs collection
 extern Jobs newJobs();
-// Add a Pipeline to the Jobs collection
-extern void addJobs(Jobs jobs, Pipeline pipeline);
+// Add a Pipeline to the Jobs collection; returns the new job's ID
+extern int addJobs(Jobs jobs, Pipeline pipeline);
 // Return the number of Pipelines in the Jobs collection
 extern int sizeJobs(Jobs jobs);
 // Free the Jobs collection and all its Pipelines
 extern void freeJobs(Jobs jobs);
 
-// Set the process IDs for the jobs
-extern void setJobPids(Jobs jobs, pid_t *pids, int num_pids);
-// Print the list of jobs with their statuses
-extern void printJobs(Jobs jobs);
+// Set the process IDs for the job with an ID
+extern void setJobPids(Jobs jobs, int job_id, pid_t *pids, int num_pids);
+// Note a SIGCHLD, for reapJobs(); safe to call in a signal handler
+extern void noteJobs();
+// Reap the children noted since the last call, and update their jobs
+extern void reapJobs(Jobs jobs);
+// Print the list of jobs with their statuses to out, and if lng the
+// resource usage of their processes; the ones that have ended are
+// reported once, and retired
+extern void printJobs(Jobs jobs, FILE *out, int lng);
+// Write resource usage, and real (wall-clock) seconds, on a line to out
+extern void usageJobs(FILE *out, struct rusage *ru, double real);
+// Report the jobs that have ended since the last report to out, and
+// retire them
+extern void reportJobs(Jobs jobs, FILE *out);
+// Keep at most limit ended jobs until they are reported
+extern void limitJobs(Jobs jobs, int limit);
+// Wait for a job to end or stop; returns its exit status, or -1, and
+// adds its resource usage to ru, unless it is 0
+extern int waitJob(Jobs jobs, int job_id, struct rusage *ru);
+// Wait for the background jobs with n IDs to end, or all of them (ids
+// 0), or the first of them (any, which is set to its ID); timeout is in
+// milliseconds, -1 for none
+// Returns the exit status, 127 if there is no such job, 124 on timeout
+extern int waitJobs(Jobs jobs, int *ids, int n, int any, int timeout,
+                    int *which);
 // Bring a job to the foreground
 extern void foregroundJob(Jobs jobs, int job_id);
 // Send a job to the background
 extern void backgroundJob(Jobs jobs, int job_id);
-// Mark the most recent job as stopped
-extern void markJobStopped(Jobs jobs);
 
 #endif
@@ -0,0 +1,200 @@
+/*
+ * File: parallel.c
+ * Description: Implementation of parallel.h
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25
+ */
+
+#define _GNU_SOURCE // for memfd_create() and mempcpy()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "Parallel.h"
+#include "Pipeline.h"
+#include "Command.h"
+#include "Reader.h"
+#include "error.h"
+
+#define BUFSZ (16<<10) // bytes copied at a time from a task's output
+
+// A task: one run of the command, for one input line
+typedef struct {
+  char *line; // its input line
+  int job; // its job's ID while it runs, else 0
+  int fd; // its output, kept until it is written
+  int status; // its exit status, once done
+  int done;
+} Task;
+
+// This function builds a task's command: the template's words with
+// "{}" replaced by the line, or with the line added after them
+// Returns the words, adjacent in one string, with their number in argc
+static char *words(char **tmpl, char *line, int *argc) {
+  size_t len=strlen(line), size=len+1;
+  for (char **w=tmpl; *w; w++) {
+    size+=strlen(*w)+1;
+    for (char *b=strstr(*w,"{}"); b; b=strstr(b+2,"{}"))
+      size+=len;
+  }
+  char *s=malloc(size), *p=s;
+  if (!s)
+    ERROR("malloc() failed");
+  int braces=0;
+  for (*argc=0; tmpl[*argc]; ++*argc) {
+    char *q=tmpl[*argc], *b;
+    for (; (b=strstr(q,"{}")); q=b+2, braces=1) {
+      p=mempcpy(p,q,b-q);
+      p=mempcpy(p,line,len);
+    }
+    p=stpcpy(p,q)+1;
+  }
+  if (!braces) { // the line is the last argument
+    strcpy(p,line);
+    ++*argc;
+  }
+  return s;
+}
+
+// This function starts a task as a background job, with its standard
+// output going to a file of its own
+static void start(Task *t, char **tmpl, Jobs jobs, int *eof) {
+  t->fd=memfd_create("parallel",MFD_CLOEXEC);
+  if (t->fd==-1)
+    ERROR("memfd_create() failed");
+  int argc;
+  char *s=words(tmpl,t->line,&argc);
+  Pipeline pipeline=newPipeline(0);
+  addPipeline(pipeline,newCommandFlat(s,argc,0,0));
+  free(s);
+  // The shell's standard output is swapped for the file for the while,
+  // so the task's processes start with it
+  fflush(stdout);
+  int saved=dup(STDOUT_FILENO);
+  dup2(t->fd,STDOUT_FILENO);
+  t->job=startPipeline(pipeline,jobs,eof);
+  dup2(saved,STDOUT_FILENO);
+  close(saved);
+  if (!t->job) { // it could not be launched (which has been reported)
+    t->status=127;
+    t->done=1;
+  }
+}
+
+// This function writes a task's output, and its exit status if it
+// failed, and frees it
+static void emit(Task *t, FILE *out) {
+  char buf[BUFSZ];
+  ssize_t n;
+  lseek(t->fd,0,SEEK_SET);
+  while ((n=read(t->fd,buf,sizeof(buf)))>0)
+    fwrite(buf,1,n,out);
+  fflush(out);
+  close(t->fd);
+  if (t->status)
+    fprintf(stderr,"parallel: %s: exit %d\n",t->line,t->status);
+  free(t->line);
+  t->line=0;
+}
+
+extern int execParallel(FILE *out, char **argv, Jobs jobs, int *eof) {
+  int slots=sysconf(_SC_NPROCESSORS_ONLN), ordered=0;
+  char *file=0;
+  for (argv++; *argv && **argv=='-'; argv++)
+    if (!strcmp(*argv,"-k"))
+      ordered=1;
+    else if (!strcmp(*argv,"-j") && argv[1])
+      slots=atoi(*++argv);
+    else if (!strcmp(*argv,"-a") && argv[1])
+      file=*++argv;
+    else
+      break;
+  if (!*argv || **argv=='-' || slots<1) {
+    fprintf(stderr,"parallel: usage: parallel [-j N] [-k] [-a file] "
+            "command [argument ...]\n");
+    return 255;
+  }
+  // The lines are read with a reader, not stdio: a task that is a
+  // forked built-in would move a shared offset back as it exits
+  int fd=file ? open(file,O_RDONLY|O_CLOEXEC) : STDIN_FILENO;
+  if (fd==-1) {
+    fprintf(stderr,"parallel: %s: %s\n",file,strerror(errno));
+    return 255;
+  }
+  Reader in=newReader(fd);
+
+  Task *tasks=0; // every task, in input order
+  int n=0, size=0;
+  int first=0; // the first task not written, with -k
+  int *ids=malloc(slots*sizeof(*ids)); // the running tasks' jobs
+  int *slot=malloc(slots*sizeof(*slot)); // and the tasks
+  if (!ids || !slot)
+    ERROR("malloc() failed");
+  int running=0, failed=0, more=1;
+  for (;;) {
+    // Fill the free slots
+    while (more && running<slots) {
+      char *line=nextReader(in);
+      if (!line) {
+        more=0;
+        break;
+      }
+      if (n==size) {
+        size=size ? 2*size : 64;
+        tasks=realloc(tasks,size*sizeof(*tasks));
+        if (!tasks)
+          ERROR("realloc() failed");
+      }
+      Task *t=&tasks[n++];
+      *t=(Task){strdup(line),0,-1,0,0};
+      start(t,argv,jobs,eof);
+      if (t->job) {
+        ids[running]=t->job;
+        slot[running++]=n-1;
+      } else {
+        failed++;
+        if (!ordered)
+          emit(t,out);
+      }
+    }
+    // Write the outputs that are due
+    for (; ordered && first<n && tasks[first].done; first++)
+      emit(&tasks[first],out);
+    if (!running)
+      break;
+    // Wait for the next task to end: its slot is free at once
+    int which;
+    int status=waitJobs(jobs,ids,running,1,-1,&which);
+    if (!which)
+      break; // (the rest have stopped: they stay jobs)
+    int s=0;
+    while (ids[s]!=which)
+      s++;
+    Task *t=&tasks[slot[s]];
+    t->status=status;
+    t->done=1;
+    t->job=0;
+    ids[s]=ids[--running];
+    slot[s]=slot[running];
+    if (status)
+      failed++;
+    if (!ordered)
+      emit(t,out);
+  }
+  for (int i=0; i<n; i++) // (only if some have stopped)
+    if (tasks[i].line) {
+      close(tasks[i].fd);
+      free(tasks[i].line);
+    }
+  free(tasks);
+  free(ids);
+  free(slot);
+  freeReader(in);
+  if (file)
+    close(fd);
+  return failed>101 ? 101 : failed;
+}
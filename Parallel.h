@@ -0,0 +1,23 @@
+/*
+ * File: parallel.h
+ * Description: Header file for the parallel built-in, which runs a
+ * command once per input line, as background jobs, at most N at a time.
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25
+ */
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdio.h>
+#include "Jobs.h"
+
+// parallel [-j N] [-k] [-a file] command [argument ...]
+// Runs command for each line of file (or standard input), with "{}" in
+// its words replaced by the line (or the line added as a last argument),
+// keeping N tasks running (by default, one per CPU); each task's output
+// is written to out when it ends, or in input order with -k
+// Returns the number of tasks that failed (at most 101), or 255 for a
+// bad usage
+extern int execParallel(FILE *out, char **argv, Jobs jobs, int *eof);
+
+#endif
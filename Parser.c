@@ -8,155 +8,233 @@
  #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <setjmp.h>
 
 #include "Parser.h"
 #include "Tree.h"
 #include "Scanner.h"
 #include "error.h"
 
-static Scanner scan;
+// Representation of a parser
+// All parse state lives here, so parses in different threads
+// (or one inside another) do not interfere
+typedef struct {
+  Scanner scan;
+  Arena arena;     // where the tree being parsed lives, 0 for malloc()
+  jmp_buf fail;    // where a syntax error unwinds to
+  char error[256]; // message for the last syntax error, "" if none
+} *ParserRep;
 
+// A syntax error records its message and abandons the parse
 #undef ERROR
-#define ERROR(s) ERRORLOC(__FILE__,__LINE__,"error","%s (pos: %d)",s,posScanner(scan))
+#define ERROR(s) fail(p,__FILE__,__LINE__,s)
 
-static char *next()       { return nextScanner(scan); } 
-static char *curr()       { return currScanner(scan); } 
-static int   cmp(char *s) { return cmpScanner(scan,s); } 
-static int   eat(char *s) { return eatScanner(scan,s); }
+static void fail(ParserRep p, char *file, int line, char *s) {
+  snprintf(p->error,sizeof(p->error),"%s:%d: error: %s (pos: %d)",
+           file,line,s,posScanner(p->scan));
+  longjmp(p->fail,1);
+}
+
+static int   next(ParserRep p)          { return advScanner(p->scan); } 
+static Token tok(ParserRep p)           { return tokScanner(p->scan); } 
+static int   take(ParserRep p, Token t) { return takeScanner(p->scan,t); }
+
+// This function copies the current token into the tree's memory
+static char *copy(ParserRep p) {
+  if (!p->arena)
+    return dupScanner(p->scan);
+  int off, len;
+  spanScanner(p->scan,&off,&len);
+  return strndupArena(p->arena,bufScanner(p->scan)+off,len);
+}
 
-static T_word p_word();
-static T_words p_words();
-static T_command p_command();
-static T_pipeline p_pipeline();
-static T_sequence p_sequence();
+static T_word p_word(ParserRep p);
+static T_words p_words(ParserRep p);
+static T_command p_command(ParserRep p);
+static T_pipeline p_pipeline(ParserRep p);
+static T_sequence p_sequence(ParserRep p);
 
 // This function parses a single word from the input
-static T_word p_word() {
-  char *s=curr(); 
-  if (!s)
+static T_word p_word(ParserRep p) {
+  if (tok(p)!=TOK_WORD)
     return 0;
-  T_word word=new_word();
-  word->s=strdup(s);
-  next();
+  char *s=copy(p); // the word's only copy, taken straight from the scan buffer
+  T_word word=new_word(p->arena);
+  word->s=s;
+  next(p);
   return word;
 }
 
-// This function parses a list of words until it hits a special token
-static T_words p_words() {
-  T_word word=p_word(); 
-  if (!word)
-    return 0;
-  T_words words=new_words();
-  words->word=word;
-  // Stop parsing words when we hit a special token
-  if (cmp("|") || cmp("&") || cmp(";") || cmp("<") || cmp(">") ||
-      cmp("{") || cmp("}") || cmp("(") || cmp(")"))
-    return words;
-  words->words=p_words();
-  return words;
+// This function parses a list of words until it hits an operator
+// It loops rather than recursing, so a line with any number of
+// words uses a fixed amount of stack
+static T_words p_words(ParserRep p) {
+  T_words head=0;
+  T_words *tail=&head; // where the next list node is linked in
+  T_word word;
+  // Stop parsing words when we hit an operator
+  while ((word=p_word(p))) {
+    T_words words=new_words(p->arena);
+    words->word=word;
+    *tail=words;
+    tail=&words->words;
+  }
+  return head;
 }
 
 // handle input/output redirection
-static void p_redir(T_command command) {
-  if (eat("<")) { // input redirection
-    char *s=curr(); // get current token, should be filename
-    if (!s) // if no token, error
+static void p_redir(ParserRep p, T_command command) {
+  if (take(p,TOK_LT)) { // input redirection
+    if (tok(p)!=TOK_WORD) // if no filename, error
       ERROR("expected filename after <");
-    // We copy the filename into the command structure
-    // strdup allocates memory for the string
-    command->infile=strdup(s); 
-    next(); // move to next token
+    command->infile=copy(p); // copy the filename into the command 
+    next(p); // move to next token
   }
-  if (eat(">")) { // output redirection
-    char *s=curr(); // get current token, should be filename
-    if (!s) // if no token, error
+  if (take(p,TOK_GT)) { // output redirection
+    if (tok(p)!=TOK_WORD) // if no filename, error
       ERROR("expected filename after >");
-    // We copy the filename into the command structure
-    // strdup allocates memory for the string
-    command->outfile=strdup(s);
-    next(); // move to next token
+    command->outfile=copy(p); // copy the filename into the command
+    next(p); // move to next token
   }
 }
 
 // This function parses a command, which can be a simple command or a block
-static T_command p_command() {
+static T_command p_command(ParserRep p) {
   // Check for ( sequence )
-  if (cmp("(")) { // if current token is (
-    next();
-    T_command command=new_command(); // create new command
-    command->block=p_sequence(); // parse the sequence inside the parenstheses
+  if (tok(p)==TOK_LPAREN) { // if current token is (
+    next(p);
+    T_command command=new_command(p->arena); // create new command
+    command->block=p_sequence(p); // parse the sequence inside the parenstheses
     command->subshell=1; // mark as subshell command
-    if (!eat(")")) // expect closing )
+    if (!take(p,TOK_RPAREN)) // expect closing )
       ERROR("expected )");
-    p_redir(command); // check for input/output redirection
+    p_redir(p,command); // check for input/output redirection
     return command;
   }
   
   // Check for { sequence }
-  if (cmp("{")) {
-    next();
-    T_command command=new_command();
-    command->block=p_sequence();
+  if (tok(p)==TOK_LBRACE) {
+    next(p);
+    T_command command=new_command(p->arena);
+    command->block=p_sequence(p);
     command->subshell=0; // mark as block command
-    if (!eat("}"))
+    if (!take(p,TOK_RBRACE))
       ERROR("expected }");
-    p_redir(command);
+    p_redir(p,command);
     return command;
   }
   // Simple command
   T_words words=0;
-  words=p_words();
+  words=p_words(p);
   if (!words)
     return 0;
-  T_command command=new_command();
+  T_command command=new_command(p->arena);
   command->words=words; // set the words
   command->infile=0; // no input redirection by default
   command->outfile=0; // no output redirection by default
-  p_redir(command); // check for input/output redirection
+  p_redir(p,command); // check for input/output redirection
   return command;
 }
 
 // This function parses a pipeline of commands separated by |
-static T_pipeline p_pipeline() {
-  T_command command=p_command(); 
-  if (!command)
-    return 0;
-  T_pipeline pipeline=new_pipeline();
-  pipeline->command=command;
-  if (eat("|")) // if we see a pipe
-    pipeline->pipeline=p_pipeline(); // parse the next command in the pipeline
-  return pipeline;
+static T_pipeline p_pipeline(ParserRep p) {
+  T_pipeline head=0;
+  T_pipeline *tail=&head;
+  do {
+    T_command command=p_command(p); 
+    if (!command)
+      break;
+    T_pipeline pipeline=new_pipeline(p->arena);
+    pipeline->command=command;
+    *tail=pipeline;
+    tail=&pipeline->pipeline;
+  } while (take(p,TOK_PIPE)); // if we see a pipe, parse the next command
+  return head;
 }
 
 // This function parses a sequence of pipelines separated by & or ;
-static T_sequence p_sequence() {
-  // Stop if we hit a closing brace or paren
-  if (cmp("}") || cmp(")"))
-    return 0;
-  T_pipeline pipeline=p_pipeline();
-  if (!pipeline)
-    return 0;
-  T_sequence sequence=new_sequence();
-  sequence->pipeline=pipeline; 
-  // Check for & or ; to continue the sequence
-  if (eat("&")) {
-    sequence->op="&";
-    sequence->sequence=p_sequence();
+static T_sequence p_sequence(ParserRep p) {
+  T_sequence head=0;
+  T_sequence *tail=&head;
+  for (;;) {
+    // Stop if we hit a closing brace or paren
+    if (tok(p)==TOK_RBRACE || tok(p)==TOK_RPAREN)
+      break;
+    T_pipeline pipeline=p_pipeline(p);
+    if (!pipeline)
+      break;
+    T_sequence sequence=new_sequence(p->arena);
+    sequence->pipeline=pipeline; 
+    *tail=sequence;
+    tail=&sequence->sequence;
+    // Check for & or ; to continue the sequence
+    if (take(p,TOK_AMP))
+      sequence->op="&";
+    else if (take(p,TOK_SEMI))
+      sequence->op=";";
+    else
+      break;
   }
-  if (eat(";")) {
-    sequence->op=";";
-    sequence->sequence=p_sequence();
+  return head;
+}
+
+// This function creates a new parser
+extern Parser newParser() {
+  ParserRep p=(ParserRep)malloc(sizeof(*p));
+  if (!p)
+    ERRORLOC(__FILE__,__LINE__,"error","malloc() failed");
+  p->scan=0;
+  p->arena=0;
+  p->error[0]=0;
+  return p;
+}
+
+// This function frees a parser
+extern void freeParser(Parser parser) {
+  free(parser);
+}
+
+// This function parses a line with a parser
+// arguments:
+//   parser - the parser to use
+//   s - the line to parse
+//   arena - arena to hold the tree, or 0 to malloc() it for freeTree()
+// returns the tree, or 0 with errorParser() set on a syntax error
+extern Tree parseParser(Parser parser, char *s, Arena arena) {
+  ParserRep p=(ParserRep)parser;
+  p->arena=arena;
+  p->error[0]=0;
+  p->scan=viewScanner(s); // scan s in place: it outlives the parse
+  Tree tree=0;
+  if (!setjmp(p->fail)) {
+    tree=p_sequence(p); // parse the sequence
+    if (tok(p)!=TOK_EOS)
+      ERROR("extra characters at end of input");
   }
-  return sequence;
+  // a malloc()'d tree abandoned by an error is lost; arenas are reset
+  freeScanner(p->scan); // free the scanner
+  p->scan=0;
+  return p->error[0] ? 0 : tree; // return the parse tree
 }
 
-// This function executes the parsing process
-extern Tree parseTree(char *s) {
-  scan=newScanner(s); // create a new scanner
-  Tree tree=p_sequence(); // parse the sequence
-  if (curr())
-    ERROR("extra characters at end of input");
-  freeScanner(scan); // free the scanner
+// This function gets the message for the last syntax error
+extern char *errorParser(Parser parser) {
+  ParserRep p=(ParserRep)parser;
+  return p->error[0] ? p->error : 0;
+}
+
+// This function parses a line, exiting on a syntax error
+// arguments:
+//   s - the line to parse
+//   arena - arena to hold the tree, or 0 to malloc() it for freeTree()
+extern Tree parseTree(char *s, Arena arena) {
+  Parser parser=newParser();
+  Tree tree=parseParser(parser,s,arena);
+  if (errorParser(parser)) {
+    fprintf(stderr,"%s\n",errorParser(parser));
+    exit(1);
+  }
+  freeParser(parser);
   return tree; // return the parse tree
 }
 
@@ -177,11 +255,12 @@ static void f_word(T_word t) {
 
 // free the words structure
 static void f_words(T_words t) {
-  if (!t)
-    return;
-  f_word(t->word); // free the single word
-  f_words(t->words); // free the rest of the words
-  free(t);
+  while (t) {
+    T_words next=t->words; // the rest of the words
+    f_word(t->word); // free the single word
+    free(t);
+    t=next;
+  }
 }
 
 // free the command structure: words and redirection strings
@@ -201,20 +280,22 @@ static void f_command(T_command t) {
 
 // free the pipeline structure
 static void f_pipeline(T_pipeline t) {
-  if (!t)
-    return;
-  f_command(t->command); // free the command
-  f_pipeline(t->pipeline); // free the next pipeline
-  free(t);
+  while (t) {
+    T_pipeline next=t->pipeline; // the next pipeline
+    f_command(t->command); // free the command
+    free(t);
+    t=next;
+  }
 }
 
 // free the sequence structure
 static void f_sequence(T_sequence t) {
-  if (!t)
-    return;
-  f_pipeline(t->pipeline); // free the pipeline
-  f_sequence(t->sequence); // free the next sequence
-  free(t);
+  while (t) {
+    T_sequence next=t->sequence; // the next sequence
+    f_pipeline(t->pipeline); // free the pipeline
+    free(t);
+    t=next;
+  }
 }
 
 // free the entire parse tree
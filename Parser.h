@@ -7,10 +7,28 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include "Arena.h"
+
 typedef void *Tree;
-// Parse the input string into a parse tree
-extern Tree parseTree(char *s);
-// Free the parse tree
+typedef void *Parser;
+
+// Parse the input string into a parse tree, exiting on a syntax error
+// The string ends at a NUL or a newline, so lines of a mapped file
+// can be parsed where they lie
+// If arena is not 0, the whole tree lives in it and is released
+// with resetArena(); otherwise it is malloc()'d and freed by freeTree()
+extern Tree parseTree(char *s, Arena arena);
+
+// Create a new parser, holding the state of one parse at a time
+extern Parser newParser();
+// Free a parser
+extern void freeParser(Parser parser);
+// Parse the input string into a parse tree, as parseTree() does
+// Returns 0 on a syntax error, leaving the message in errorParser()
+extern Tree parseParser(Parser parser, char *s, Arena arena);
+// Get the message for the last syntax error, or 0 if there was none
+extern char *errorParser(Parser parser);
+// Free a parse tree that was not parsed into an arena
 extern void freeTree(Tree t);
 
 #endif
@@ -0,0 +1,177 @@
+/*
+ * File: path.c
+ * Description: Implementation of path.h
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "Path.h"
+#include "error.h"
+
+// A command name and the file it runs, in one allocation
+typedef struct Entry {
+  struct Entry *chain;  // next entry in the same hash bucket
+  uint64_t hash;
+  long hits;            // lookups answered from the table
+  char *file;           // the file, or 0 if name is not in PATH
+  char name[];          // the key, followed by the file
+} *Entry;
+
+static Entry *buckets=0;
+static int nbuckets=0;
+static int entries=0;
+static char *path=0; // the PATH the table was filled from
+
+// This function hashes a name (64-bit FNV-1a)
+static uint64_t hash(char *s) {
+  uint64_t h=14695981039346656037ULL;
+  for (; *s; s++)
+    h=(h^(unsigned char)*s)*1099511628211ULL;
+  return h;
+}
+
+// This function doubles the hash table
+static void grow() {
+  int n=nbuckets ? 2*nbuckets : 64;
+  Entry *b=(Entry *)calloc(n,sizeof(*b));
+  if (!b)
+    ERROR("calloc() failed");
+  for (int i=0; i<nbuckets; i++)
+    while (buckets[i]) {
+      Entry e=buckets[i];
+      buckets[i]=e->chain;
+      e->chain=b[e->hash&(n-1)];
+      b[e->hash&(n-1)]=e;
+    }
+  free(buckets);
+  buckets=b;
+  nbuckets=n;
+}
+
+// This function finds the bucket link to the entry for a name
+static Entry *find(uint64_t h, char *name) {
+  Entry *p=&buckets[h&(nbuckets-1)];
+  while (*p && ((*p)->hash!=h || strcmp((*p)->name,name)))
+    p=&(*p)->chain;
+  return p;
+}
+
+// This function searches PATH for an executable regular file,
+// as execvp() would; an empty PATH entry is the current directory
+// Returns the file in buf, or 0
+static char *search(char *name, char *buf, long size) {
+  char *dirs=path;
+  while (dirs) {
+    char *end=strchr(dirs,':');
+    int len=end ? end-dirs : (int)strlen(dirs);
+    if (snprintf(buf,size,"%.*s%s%s",len,dirs,len ? "/" : "",name)<size) {
+      struct stat st;
+      if (!stat(buf,&st) && S_ISREG(st.st_mode) && !access(buf,X_OK))
+        return buf;
+    }
+    dirs=end ? end+1 : 0;
+  }
+  return 0;
+}
+
+// This function checks that the table was filled from the current PATH
+static void check() {
+  char *now=getenv("PATH");
+  if (!now)
+    now="/bin:/usr/bin"; // execvp()'s default
+  if (path && !strcmp(path,now))
+    return;
+  clearPath();
+  free(path);
+  path=strdup(now);
+  if (!path)
+    ERROR("strdup() failed");
+}
+
+// This function finds the file a command name runs
+// A miss searches PATH once and remembers the answer, found or not
+// arguments:
+//   name - the command name
+extern char *findPath(char *name) {
+  if (strchr(name,'/'))
+    return name; // not looked up in PATH
+  check();
+  if (2*entries>=nbuckets)
+    grow();
+  uint64_t h=hash(name);
+  Entry *p=find(h,name);
+  if (*p) {
+    (*p)->hits++;
+    return (*p)->file;
+  }
+  int len=strlen(name);
+  char buf[4096];
+  char *file=search(name,buf,sizeof(buf));
+  Entry e=(Entry)malloc(sizeof(*e)+len+1+(file ? strlen(file)+1 : 0));
+  if (!e)
+    ERROR("malloc() failed");
+  e->chain=0;
+  e->hash=h;
+  e->hits=0;
+  strcpy(e->name,name);
+  e->file=file ? strcpy(e->name+len+1,file) : 0;
+  *p=e;
+  entries++;
+  return e->file;
+}
+
+// This function forgets a name
+extern void forgetPath(char *name) {
+  if (!nbuckets)
+    return;
+  Entry *p=find(hash(name),name);
+  if (*p) {
+    Entry e=*p;
+    *p=e->chain;
+    free(e);
+    entries--;
+  }
+}
+
+// This function removes every name from the table
+extern void clearPath() {
+  for (int i=0; i<nbuckets; i++)
+    while (buckets[i]) {
+      Entry e=buckets[i];
+      buckets[i]=e->chain;
+      free(e);
+    }
+  entries=0;
+}
+
+// This function prints the table, like bash's hash
+extern void printPath(FILE *out) {
+  if (!entries) {
+    fprintf(out,"hash: hash table empty\n");
+    return;
+  }
+  fprintf(out,"hits\tcommand\n");
+  for (int i=0; i<nbuckets; i++)
+    for (Entry e=buckets[i]; e; e=e->chain)
+      if (e->file)
+        fprintf(out,"%4ld\t%s\n",e->hits,e->file);
+      else
+        fprintf(out,"%4ld\t%s (not found)\n",e->hits,e->name);
+}
+
+// This function frees the table
+extern void freePath() {
+  clearPath();
+  free(buckets);
+  buckets=0;
+  nbuckets=0;
+  free(path);
+  path=0;
+}
@@ -0,0 +1,26 @@
+/*
+ * File: path.h
+ * Description: Header file for the command path table, which remembers
+ * where in PATH each command name was found (or that it was not).
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25 
+ */
+#ifndef PATH_H
+#define PATH_H
+
+#include <stdio.h>
+
+// Find the file a command name runs, searching PATH on a miss
+// A name with a / is returned as is; 0 means it is not in PATH
+// The table is emptied whenever PATH changes
+extern char *findPath(char *name);
+// Forget where a name was found (its file went away)
+extern void forgetPath(char *name);
+// Remove every name from the table
+extern void clearPath();
+// Print the table with the hit count of each name
+extern void printPath(FILE *out);
+// Free the table
+extern void freePath();
+
+#endif
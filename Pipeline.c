@@ -5,12 +5,18 @@
  * Date: 10/18/25 
  */
 
+#define _GNU_SOURCE // for pipe2()
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
 
 #include "Pipeline.h"
 #include "deq.h"
@@ -20,6 +26,8 @@
 typedef struct {
   Deq processes;
   int fg;
+  int timed; // 1 after a "time" word, -1 until it is looked for
+  struct rusage *usage; // where the job's usage goes, if timed
 } *PipelineRep;
 
 // This function creates a new pipeline
@@ -32,6 +40,8 @@ extern Pipeline newPipeline(int fg) {
   r->processes=deq_new();
   // Set foreground/background flag
   r->fg=fg;
+  r->timed=-1;
+  r->usage=0;
   return r;
 }
 
@@ -44,6 +54,41 @@ extern void addPipeline(Pipeline pipeline, Command command) {
   deq_tail_put(r->processes,command);
 }
 
+static int pipesize=0; // bytes of each pipe's buffer, 0 for the default
+
+// This function sets the buffer size of the pipes made for pipelines,
+// clamped to /proc/sys/fs/pipe-max-size; 0 is the kernel's default
+// (64 KiB), and a negative size leaves it as it is
+// Returns the size the kernel gives a pipe now (it rounds up to a
+// power of two pages, and may refuse more than a user's share)
+// arguments:
+//   bytes - the size asked for
+extern long bufferPipeline(long bytes) {
+  if (bytes > 0) {
+    long max = 1 << 20; // (the kernel's default)
+    FILE *f = fopen("/proc/sys/fs/pipe-max-size", "re");
+    if (f) {
+      if (fscanf(f, "%ld", &max) != 1)
+        max = 1 << 20;
+      fclose(f);
+    }
+    if (bytes > max)
+      bytes = max;
+  }
+  if (bytes >= 0)
+    pipesize = bytes;
+  // A pipe shows what applies
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) == -1)
+    return -1;
+  if (pipesize && fcntl(fds[1], F_SETPIPE_SZ, pipesize) == -1)
+    pipesize = 0; // refused: back to the default
+  long size = fcntl(fds[1], F_GETPIPE_SZ);
+  close(fds[0]);
+  close(fds[1]);
+  return size;
+}
+
 // This function returns the size of the pipeline
 // arguments:
 //   pipeline - the pipeline whose size is needed
@@ -52,11 +97,137 @@ extern int sizePipeline(Pipeline pipeline) {
   return deq_len(r->processes);
 }
 
+// Output of a built-in stage too big for its pipe, which a thread
+// writes while the next stage reads it
+typedef struct Stage {
+  struct Stage *next, *prev; // the stages whose threads are writing
+  pthread_t thread;
+  char *buf;  // the output
+  size_t off; // how much of it is written
+  size_t len;
+  int fd;     // the pipe, -1 once the thread is done
+  int detached; // 1 if the thread frees it, when done
+} Stage;
+
+static pthread_mutex_t writing=PTHREAD_MUTEX_INITIALIZER; // for these
+static Stage *writers=0; // the stages whose threads are writing
+
+// These functions keep the writers' pipes out of forked processes:
+// a child closes them, with none closed or added while it forks
+// (spawned ones do not fork, and the pipes are close-on-exec)
+static void forking() {
+  pthread_mutex_lock(&writing);
+}
+
+static void forked() {
+  pthread_mutex_unlock(&writing);
+}
+
+static void child() {
+  for (Stage *s = writers; s; s = s->next)
+    close(s->fd);
+  writers = 0; // (their threads are not in this process)
+  pthread_mutex_init(&writing, 0);
+}
+
+static void atfork() {
+  pthread_atfork(forking, forked, child);
+}
+
+// This function writes the rest of a built-in stage's output
+// With signals blocked, a reader that is gone is EPIPE, not SIGPIPE
+static void *stage(void *arg) {
+  Stage *s=(Stage *)arg;
+  sigset_t all;
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, 0);
+  while (s->off < s->len) {
+    ssize_t w = write(s->fd, s->buf + s->off, s->len - s->off);
+    if (w <= 0)
+      break;
+    s->off += w;
+  }
+  free(s->buf);
+  pthread_mutex_lock(&writing);
+  close(s->fd);
+  s->fd = -1;
+  if (s->next)
+    s->next->prev = s->prev;
+  if (s->prev)
+    s->prev->next = s->next;
+  else
+    writers = s->next;
+  int detached = s->detached;
+  pthread_mutex_unlock(&writing);
+  if (detached)
+    free(s);
+  return 0;
+}
+
+// This function lets a stage's thread go: joined if the job is over,
+// else left to finish (a stopped reader may not read for a long time)
+static void release(Stage *s, int over) {
+  if (over) {
+    pthread_join(s->thread, 0);
+    free(s);
+    return;
+  }
+  pthread_mutex_lock(&writing);
+  pthread_detach(s->thread);
+  s->detached = s->fd != -1; // (else it is done: free it here)
+  pthread_mutex_unlock(&writing);
+  if (!s->detached)
+    free(s);
+}
+
+// This function runs a built-in stage into its pipe, right away
+// Returns 1 if the output fit; otherwise a thread, started at once,
+// writes the rest from s while the next stage reads it
+static int feed(Command cmd, Jobs jobs, int fd, Stage *s) {
+  FILE *out = open_memstream(&s->buf, &s->len);
+  if (!out)
+    ERROR("open_memstream() failed");
+  runCommand(cmd, jobs, out);
+  fclose(out);
+  s->off = 0;
+  s->fd = fd;
+  fcntl(fd, F_SETFL, O_NONBLOCK); // the reader has not started yet
+  while (s->off < s->len) {
+    ssize_t w = write(fd, s->buf + s->off, s->len - s->off);
+    if (w <= 0)
+      break;
+    s->off += w;
+  }
+  fcntl(fd, F_SETFL, 0);
+  s->detached = 0;
+  if (s->off < s->len) {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, atfork);
+    pthread_mutex_lock(&writing);
+    s->prev = 0;
+    s->next = writers;
+    if (writers)
+      writers->prev = s;
+    writers = s;
+    pthread_mutex_unlock(&writing);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 64 << 10); // it only write()s
+    if (pthread_create(&s->thread, &attr, stage, s))
+      ERROR("pthread_create() failed");
+    pthread_attr_destroy(&attr);
+    return 0;
+  }
+  close(fd);
+  free(s->buf);
+  return 1;
+}
+
 // This function executes the pipeline
 // arguments:
 //   pipeline - the pipeline to execute
 //   jobs - the jobs structure to manage background/foreground jobs
-//   jobbed - pointer to jobbed flag
+//   jobbed - pointer to the job ID, 0 until it is jobbed
 //   eof - pointer to EOF flag  
 static void execute(Pipeline pipeline, Jobs jobs, int *jobbed, int *eof) {
   // Get pipeline representation and size
@@ -68,92 +239,137 @@ static void execute(Pipeline pipeline, Jobs jobs, int *jobbed, int *eof) {
     // Execute single command 
     pid_t pid = execCommand(deq_head_ith(r->processes,0),pipeline,jobs,jobbed,eof,r->fg,-1,-1);
     if (pid > 0){ // If a valid PID is returned we set it in jobs
-      setJobPids(jobs, &pid, 1);
+      setJobPids(jobs, *jobbed, &pid, 1);
+      if (r->fg) // and wait for it, if foreground
+        waitJob(jobs, *jobbed, r->usage);
     }
     return;
   }
 
   // Multiple commands - pipeline
-  int num_pipes = n - 1; // Number of pipes needed
-  int pipes[num_pipes][2]; // Array to hold the pipes
-  
-  // Create the pipes
-  for (int i = 0; i < num_pipes; i++) {
-    if (pipe(pipes[i]) == -1) {
-      ERROR("pipe() failed");
-    }
-  }
+  // Each pipe is made as its stages start: the shell holds at most the
+  // read end of the last one and the next pair, all close-on-exec, so
+  // spawned stages only keep the ends they are given (a thread writing
+  // a built-in's output holds its write end until it is done)
+  pid_t *pids = malloc(sizeof(pid_t) * n); // PIDs of the stages
+  Stage **stages = malloc(sizeof(Stage *) * n); // big built-in outputs
+  if (!pids || !stages)
+    ERROR("malloc() failed");
+  int m = 0; // Number of stages running
+  int t = 0; // Number of outputs left for threads
 
-  pid_t pids[n]; // Array to hold child PIDs
+  // Hold SIGCHLD until all stages run, so a leader that exits at once
+  // stays a zombie and its process group stays joinable
+  sigset_t chld, old;
+  sigemptyset(&chld);
+  sigaddset(&chld, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &chld, &old);
 
-  // Fork and execute each command
+  // Launch each command in one process of its own; in the foreground,
+  // built-ins that only write output run in the shell (the last one
+  // after the rest)
+  int pipe_in = -1; // read end of the previous stage's pipe
   for (int i = 0; i < n; i++) {
     // we get the command
     Command cmd = deq_head_ith(r->processes, i);
-    // we determine pipe_in and pipe_out
-    int pipe_in = (i > 0) ? pipes[i - 1][0] : -1;
-    int pipe_out = (i < n - 1) ? pipes[i][1] : -1;
-
-    // Fork the process
-    pids[i] = fork();
-    if (pids[i] == -1) {
-      ERROR("fork() failed");
-    }
-    // Child process
-    if (pids[i] == 0) {
-      // Child - restore signals
-      setpgid(0, 0);  // we create a new process group
-      signal(SIGTSTP, SIG_DFL); // This allows child processes to be stopped
-      signal(SIGINT, SIG_DFL); // This allows child processes to be interrupted 
-      
-      // Close unused pipes
-      for (int j = 0; j < num_pipes; j++) {
-        if (j != i-1) close(pipes[j][0]);
-        if (j != i) close(pipes[j][1]);
+    int pure = r->fg && pureCommand(cmd);
+    int out[2] = {-1, -1}; // this stage's output pipe
+    if (pure && i < n - 1 && pureCommand(deq_head_ith(r->processes, i + 1))) {
+      // no stage reads this output: run it now, into /dev/null
+      if (pipe_in != -1)
+        close(pipe_in);
+      pipe_in = -1;
+      FILE *null = fopen("/dev/null", "we");
+      if (null) {
+        runCommand(cmd, jobs, null);
+        fclose(null);
       }
-      // Execute the command
-      execCommand(cmd, pipeline, jobs, jobbed, eof, r->fg, pipe_in, pipe_out);
-      exit(0); // Exit child process
+      continue;
     }
-    else {
-      setpgid(pids[i], pids[0]);  // Set all children to the same process group
+    if (i < n - 1 && pipe2(out, O_CLOEXEC) == -1) {
+      ERROR("pipe2() failed");
     }
-  }
+    if (out[1] != -1 && pipesize) // (if refused, the default stays)
+      fcntl(out[1], F_SETPIPE_SZ, pipesize);
+    int pipe_out = out[1];
+    pid_t pgid = m ? pids[0] : 0; // the first stage leads the group
 
-  // Parent - close all pipes
-  for (int i = 0; i < num_pipes; i++) {
-    close(pipes[i][0]);
-    close(pipes[i][1]);
-  }
-
-  // Add to jobs
-  if (!*jobbed) { 
-    *jobbed = 1; // mark as jobbed
-    addJobs(jobs, pipeline); // add pipeline to jobs
-  }
+    if (pure) { // run it now, unless it is the last stage
+      if (pipe_out != -1) {
+        if (!(stages[t] = malloc(sizeof(Stage))))
+          ERROR("malloc() failed");
+        if (feed(cmd, jobs, pipe_out, stages[t]))
+          free(stages[t]);
+        else
+          t++; // its thread writes the rest
+      }
+      pipe_out = -1; // fed and closed, or the thread's
+    } else {
+      // External commands are spawned: no fork, no extra process
+      pid_t pid = launchCommand(cmd, pgid, pipe_in, pipe_out);
+      // Built-ins and blocks: fork a process that runs the stage itself
+      if (pid == 0 && (pid = fork()) == -1) {
+        ERROR("fork() failed");
+      }
+      // Child process
+      if (pid == 0) {
+        // Child - restore signals
+        setpgid(0, pgid);  // we join the pipeline's process group
+        sigprocmask(SIG_SETMASK, &old, 0);
+        signal(SIGTSTP, SIG_DFL); // This allows child processes to be stopped
+        signal(SIGINT, SIG_DFL); // This allows child processes to be interrupted 
 
-  // Set job PIDs
-  setJobPids(jobs, pids, n); 
-
-  // Wait if foreground
-  if (r->fg) {
-    int stopped = 0;
-    // We wait for all child processes
-    for (int i = 0; i < n; i++) {
-      int status;
-      waitpid(pids[i], &status, WUNTRACED);
-      // Check if the process was stopped
-      if (WIFSTOPPED(status)) {
-        stopped = 1;
-        break;
+        // Close the pipe ends that are not this stage's (the
+        // threads' ones were closed as it forked)
+        if (out[0] != -1)
+          close(out[0]);
+        // Run the command, in this process
+        stageCommand(cmd, jobs, eof, pipe_in, pipe_out);
+      }
+      else if (pid != -1) { // (-1: could not be launched)
+        setpgid(pid, pgid ? pgid : pid);  // Set all children to the same process group
+        pids[m++] = pid;
       }
     }
-    // if pipeline was stopped we mark job as stopped
-    if (stopped) {
-      markJobStopped(jobs);
-      printf("\n");
-    }
+    // Parent - this stage has its ends now
+    if (pipe_in != -1)
+      close(pipe_in);
+    if (pipe_out != -1)
+      close(pipe_out);
+    pipe_in = out[0];
+  }
+
+  sigprocmask(SIG_SETMASK, &old, 0);
+
+  // A built-in last stage runs right here
+  Command last = deq_head_ith(r->processes, n - 1);
+  if (r->fg && pureCommand(last))
+    runCommand(last, jobs, 0);
+  int status = 0;
+  if (m) { // something runs in a process: a job
+    // Add to jobs
+    if (!*jobbed) // add pipeline to jobs; its ID marks it as jobbed
+      *jobbed = addJobs(jobs, pipeline);
+
+    // Set job PIDs
+    setJobPids(jobs, *jobbed, pids, m); 
+
+    // Wait if foreground, until it ends or stops
+    if (r->fg)
+      status = waitJob(jobs, *jobbed, r->usage);
   }
+  // Only then are the threads joined: their readers are the job's
+  for (int i = 0; i < t; i++)
+    release(stages[i], status != 128 + SIGTSTP);
+  free(stages);
+  free(pids);
+}
+
+// This function tells if a pipeline is timed, dropping its "time" word
+static int timed(PipelineRep r) {
+  if (r->timed < 0)
+    r->timed = sizePipeline(r) && timedCommand(deq_head_ith(r->processes,0));
+  return r->timed;
 }
 
 // This function executes the pipeline
@@ -162,10 +378,68 @@ static void execute(Pipeline pipeline, Jobs jobs, int *jobbed, int *eof) {
 //   jobs - the jobs structure to manage background/foreground jobs
 //   eof - pointer to EOF flag
 extern void execPipeline(Pipeline pipeline, Jobs jobs, int *eof) {
+  PipelineRep r=(PipelineRep)pipeline;
   int jobbed=0; 
+  if (!timed(r) || !r->fg) { // (a background job's usage is in jobs -l)
+    execute(pipeline,jobs,&jobbed,eof); // execute the pipeline
+    if (!jobbed) // if not jobbed, free the pipeline
+      freePipeline(pipeline);
+    return;
+  }
+  // Time it: its processes' usage, with what the shell used meanwhile
+  // (for built-ins); a job that ends is freed with its pipeline
+  struct rusage usage={{0}}, self[2];
+  struct timespec t[2];
+  clock_gettime(CLOCK_MONOTONIC,&t[0]);
+  getrusage(RUSAGE_SELF,&self[0]);
+  r->usage=&usage;
+  execute(pipeline,jobs,&jobbed,eof); // execute the pipeline
+  if (!jobbed) // if not jobbed, free the pipeline
+    freePipeline(pipeline);
+  getrusage(RUSAGE_SELF,&self[1]);
+  clock_gettime(CLOCK_MONOTONIC,&t[1]);
+  timersub(&self[1].ru_utime,&self[0].ru_utime,&self[0].ru_utime);
+  timeradd(&usage.ru_utime,&self[0].ru_utime,&usage.ru_utime);
+  timersub(&self[1].ru_stime,&self[0].ru_stime,&self[0].ru_stime);
+  timeradd(&usage.ru_stime,&self[0].ru_stime,&usage.ru_stime);
+  usage.ru_majflt+=self[1].ru_majflt-self[0].ru_majflt;
+  usage.ru_nvcsw+=self[1].ru_nvcsw-self[0].ru_nvcsw;
+  usage.ru_nivcsw+=self[1].ru_nivcsw-self[0].ru_nivcsw;
+  if (!jobbed) // all built-ins: the shell's peak
+    usage.ru_maxrss=self[1].ru_maxrss;
+  usageJobs(stderr,&usage,t[1].tv_sec-t[0].tv_sec+
+            (t[1].tv_nsec-t[0].tv_nsec)/1e9);
+}
+
+// This function starts the pipeline as a background job
+// Returns the job's ID, or 0 if no job was made
+// arguments:
+//   pipeline - the pipeline to start
+//   jobs - the jobs structure it joins
+//   eof - pointer to EOF flag
+extern int startPipeline(Pipeline pipeline, Jobs jobs, int *eof) {
+  PipelineRep r=(PipelineRep)pipeline;
+  int jobbed=0;
+  r->fg=0;
+  timed(r); // (in the background, the word is dropped)
   execute(pipeline,jobs,&jobbed,eof); // execute the pipeline
   if (!jobbed) // if not jobbed, free the pipeline
     freePipeline(pipeline);
+  return jobbed;
+}
+
+// This function executes the pipeline as the last thing this process
+// does: a lone foreground command runs in its place (see tailCommand()),
+// so nothing is forked and waited for just to exit after it
+// arguments:
+//   pipeline - the pipeline to execute
+//   jobs - the jobs structure to manage background/foreground jobs
+//   eof - pointer to EOF flag
+extern void tailPipeline(Pipeline pipeline, Jobs jobs, int *eof) {
+  PipelineRep r=(PipelineRep)pipeline;
+  if (r->fg && sizePipeline(r) == 1 && !timed(r))
+    tailCommand(deq_head_ith(r->processes,0),jobs,eof);
+  execPipeline(pipeline,jobs,eof);
 }
 
 // This function frees the resources of a pipeline
@@ -20,6 +20,15 @@ extern void addPipeline(Pipeline pipeline, Command command);
 extern int sizePipeline(Pipeline pipeline);
 // Execute the pipeline with the given jobs and EOF flag
 extern void execPipeline(Pipeline pipeline, Jobs jobs, int *eof);
+// Start the pipeline as a background job; returns its ID, or 0 if no
+// job was made (nothing ran in a process)
+extern int startPipeline(Pipeline pipeline, Jobs jobs, int *eof);
+// Execute the pipeline as the last thing this process does; a lone
+// foreground command never returns (see tailCommand())
+extern void tailPipeline(Pipeline pipeline, Jobs jobs, int *eof);
+// Set the buffer size of pipelines' pipes (0 for the kernel's default,
+// negative to leave it); returns the size that applies
+extern long bufferPipeline(long bytes);
 // Free the resources associated with the pipeline
 extern void freePipeline(Pipeline pipeline);
 
@@ -0,0 +1,119 @@
+/*
+ * File: reader.c
+ * Description: Implementation of reader.h
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "Reader.h"
+#include "error.h"
+
+#define BLOCKSIZE 65536 // bytes asked for per read
+
+// Representation of a reader
+// Lines are cut out of buf in place, so a line costs no copy.
+// For a regular file, the file offset is kept at the start of the
+// next unread line, so a command that reads the shell's stdin sees
+// exactly the rest of the input, as it did with readline; if the
+// command moves the offset, reading carries on from there.
+// A pipe cannot be rewound: commands see input after the block read.
+typedef struct {
+  int fd;
+  char *buf;
+  long size; // bytes allocated for buf
+  long pos;  // start of the next line
+  long end;  // end of the bytes read
+  int eof;
+  int seekable; // 1 for a regular file
+  off_t off;    // file offset of buf[end], when seekable
+} *ReaderRep;
+
+// This function creates a new reader for fd
+extern Reader newReader(int fd) {
+  ReaderRep r=(ReaderRep)malloc(sizeof(*r));
+  if (!r)
+    ERROR("malloc() failed");
+  r->fd=fd;
+  r->size=BLOCKSIZE+1; // room for a NUL after a full block
+  r->buf=(char *)malloc(r->size);
+  if (!r->buf)
+    ERROR("malloc() failed");
+  r->pos=r->end=0;
+  r->eof=0;
+  struct stat st;
+  r->off=lseek(fd,0,SEEK_CUR);
+  r->seekable=!fstat(fd,&st) && S_ISREG(st.st_mode) && r->off!=-1;
+  return r;
+}
+
+// This function reads another block onto the end of buf
+// Returns 0 at end of input
+static int fill(ReaderRep r) {
+  if (r->pos) { // move the partial line to the front
+    memmove(r->buf,r->buf+r->pos,r->end-r->pos);
+    r->end-=r->pos;
+    r->pos=0;
+  }
+  if (r->size-r->end<BLOCKSIZE+1) { // a long line: grow
+    r->size*=2;
+    r->buf=(char *)realloc(r->buf,r->size);
+    if (!r->buf)
+      ERROR("realloc() failed");
+  }
+  long n;
+  if (r->seekable) // leave the file offset alone
+    n=pread(r->fd,r->buf+r->end,r->size-r->end-1,r->off);
+  else
+    n=read(r->fd,r->buf+r->end,r->size-r->end-1);
+  if (n<=0)
+    return 0;
+  r->end+=n;
+  r->off+=n;
+  return 1;
+}
+
+// This function gets the next line
+extern char *nextReader(Reader reader) {
+  ReaderRep r=(ReaderRep)reader;
+  if (r->seekable) {
+    // if a command read from the file, carry on where it stopped
+    off_t now=lseek(r->fd,0,SEEK_CUR);
+    if (now!=r->off-(r->end-r->pos)) {
+      r->pos=r->end=0;
+      r->off=now;
+      r->eof=0;
+    }
+  }
+  char *line=r->buf+r->pos;
+  char *nl;
+  while (!(nl=memchr(line,'\n',r->end-r->pos))) {
+    int more=!r->eof && fill(r);
+    line=r->buf+r->pos; // fill() may move the line
+    if (!more) {
+      r->eof=1;
+      if (r->pos==r->end)
+        return 0;
+      nl=r->buf+r->end; // a last line with no newline
+      break;
+    }
+  }
+  *nl=0;
+  r->pos=nl-r->buf+(nl<r->buf+r->end);
+  if (r->seekable) // commands start reading after this line
+    lseek(r->fd,r->off-(r->end-r->pos),SEEK_SET);
+  return line;
+}
+
+// This function frees the reader
+extern void freeReader(Reader reader) {
+  ReaderRep r=(ReaderRep)reader;
+  free(r->buf);
+  free(r);
+}
@@ -0,0 +1,21 @@
+/*
+ * File: reader.h
+ * Description: Header file for the batch reader, which reads
+ * non-interactive input in large blocks and splits it into lines.
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25 
+ */
+#ifndef READER_H
+#define READER_H
+
+typedef void *Reader;
+
+// Create a new reader for file descriptor fd
+extern Reader newReader(int fd);
+// Get the next line, without its newline, or 0 at end of input
+// The line belongs to the reader and lasts until the next call
+extern char *nextReader(Reader reader);
+// Free the reader (fd is left open)
+extern void freeReader(Reader reader);
+
+#endif
@@ -13,69 +13,165 @@
 #include "error.h"
 
 // Representation of a scanner
+// Tokens are kept as a span (off, len) of str, so scanning a token
+// costs no allocation. The scratch buffer tmp is only filled when
+// a caller asks for the token as a string with currScanner().
 typedef struct {
   int eos;
   char *str;
   char *pos;
-  char *curr;
+  int curr; // 1 if (off, len) holds the current token
+  Token tok; // type of the current token
+  int off;
+  int len;
+  char *tmp; // NUL-terminated copy of the current token, reused
+  int tmpsize;
+  int owned; // 1 if str is the scanner's own copy
 } *ScannerRep;
 
-// This function creates a new scanner for string
-extern Scanner newScanner(char *s) {
+// This function creates a scanner over s, copying it if owned
+static ScannerRep scanner(char *s, int owned) {
   // Allocate scanner structure
   ScannerRep r=(ScannerRep)malloc(sizeof(*r));
   if (!r)
     ERROR("malloc() failed");
   r->eos=0; //this indicates end of string not reached
-  r->str=strdup(s);// this makes a copy of the string
+  r->owned=owned;
+  r->str=owned ? strdup(s) : s;// this makes a copy of the string
+  if (!r->str)
+    ERROR("strdup() failed");
   r->pos=r->str; // this is the current position in the string
-  r->curr=0; // this is the current token
+  r->curr=0; // there is no current token yet
+  r->tok=TOK_EOS;
+  r->off=r->len=0;
+  r->tmp=0; // scratch buffer is allocated on first use
+  r->tmpsize=0;
   return r;
 }
 
+// This function creates a new scanner for string
+extern Scanner newScanner(char *s) {
+  return scanner(s,1);
+}
+
+// This function creates a new scanner that reads s in place
+extern Scanner viewScanner(char *s) {
+  return scanner(s,0);
+}
+
 // This function frees the resources of the scanner
 extern void freeScanner(Scanner scan) {
   ScannerRep r=scan; 
-  free(r->str);
-  if (r->curr) // free current token if it exists
-    free(r->curr);
+  if (r->owned)
+    free(r->str);
+  if (r->tmp) // free scratch buffer if it exists
+    free(r->tmp);
   free(r);
 }
 
-// These functions help to navigate through the string
-static char *thru(char *p, char *q) {
-  for (; *p && strchr(q,*p); p++);
-  return p;
-}
-static char *upto(char *p, char *q) {
-  for (; *p && !strchr(q,*p); p++);
-  return p;
-}
+// Character classes for the lexer
+// Every byte is classified by one table lookup, so a token is
+// found in a single pass with no per-character strchr() calls.
+enum { C_WORD, C_SPACE, C_END, C_META, C_QUOTE };
 
-static char *wsthru(char *p) { return thru(p," \t"); }
-static char *wsupto(char *p) { return upto(p," \t"); }
+static const unsigned char cls[256]={
+  ['\0']=C_END, ['\n']=C_END, // a line ends at NUL or newline
+  ['"']=C_QUOTE, ['\'']=C_QUOTE,
+  [' ']=C_SPACE, ['\t']=C_SPACE,
+  ['|']=C_META, [';']=C_META, ['&']=C_META, ['<']=C_META,
+  ['>']=C_META, ['(']=C_META, [')']=C_META,
+};
 
-// This function gets the next token from the scanner
-extern char *nextScanner(Scanner scan) {
+// Token type of each metacharacter
+static const Token meta[256]={
+  ['|']=TOK_PIPE, [';']=TOK_SEMI, ['&']=TOK_AMP, ['<']=TOK_LT,
+  ['>']=TOK_GT, ['(']=TOK_LPAREN, [')']=TOK_RPAREN,
+};
+
+#define CLS(p) cls[(unsigned char)*(p)]
+
+// This function moves to the next token, recording it as a span
+// Returns 0 at end of string
+extern int advScanner(Scanner scan) {
   ScannerRep r=scan;
   if (r->eos)
     return 0;
-  char *old=wsthru(r->pos);
-  char *new=wsupto(old);
-  int size=new-old;
-  if (size==0) {
+  char *old=r->pos;
+  while (CLS(old)==C_SPACE)
+    old++;
+  char *new=old;
+  switch (CLS(old)) {
+  case C_END:
     r->eos=1;
+    r->curr=0;
+    r->tok=TOK_EOS;
     return 0;
+  case C_META: // operators are always one character
+    r->tok=meta[(unsigned char)*new++];
+    break;
+  default:
+    // a quoted run is part of the word, operators and spaces included;
+    // the quotes themselves are kept, since words are never unquoted
+    for (;;) {
+      while (CLS(new)==C_WORD)
+        new++;
+      if (CLS(new)!=C_QUOTE)
+        break;
+      char quote=*new++;
+      while (CLS(new)!=C_END && *new!=quote)
+        new++;
+      if (*new==quote)
+        new++;
+    }
+    r->tok=TOK_WORD;
+    // braces are reserved words, not operators
+    if (new-old==1 && *old=='{')
+      r->tok=TOK_LBRACE;
+    if (new-old==1 && *old=='}')
+      r->tok=TOK_RBRACE;
   }
-  if (r->curr)
-    free(r->curr);
-  r->curr=(char *)malloc(size+1);
-  if (!r->curr)
-    ERROR("malloc() failed");
-  memmove(r->curr,old,size);
-  (r->curr)[size]=0;
+  r->curr=1;
+  r->off=old-r->str;
+  r->len=new-old;
   r->pos=new;
-  return r->curr;
+  return 1;
+}
+
+// This function gets the type of the current token
+extern Token tokScanner(Scanner scan) {
+  ScannerRep r=scan;
+  if (!r->curr && !advScanner(scan))
+    return TOK_EOS;
+  return r->tok;
+}
+
+// This function eats the current token if it has the given type
+extern int takeScanner(Scanner scan, Token tok) {
+  if (tokScanner(scan)!=tok)
+    return 0;
+  advScanner(scan);
+  return 1;
+}
+
+// This function copies the current token into the scratch buffer
+static char *str(ScannerRep r) {
+  if (r->len+1>r->tmpsize) {
+    r->tmpsize=2*(r->len+1);
+    r->tmp=(char *)realloc(r->tmp,r->tmpsize);
+    if (!r->tmp)
+      ERROR("realloc() failed");
+  }
+  memmove(r->tmp,r->str+r->off,r->len);
+  (r->tmp)[r->len]=0;
+  return r->tmp;
+}
+
+// This function gets the next token from the scanner
+extern char *nextScanner(Scanner scan) {
+  ScannerRep r=scan;
+  if (!advScanner(scan))
+    return 0;
+  return str(r);
 }
 
 // This function gets the current token from the scanner
@@ -84,17 +180,45 @@ extern char *currScanner(Scanner scan) {
   if (r->eos)
     return 0;
   if (r->curr)
-    return r->curr;
+    return str(r);
   return nextScanner(scan);
 }
 
+// This function gets the current token as a span of the buffer
+// Returns 0 at end of string
+extern int spanScanner(Scanner scan, int *off, int *len) {
+  ScannerRep r=scan;
+  if (!r->curr && !advScanner(scan))
+    return 0;
+  *off=r->off;
+  *len=r->len;
+  return 1;
+}
+
+// This function gets the buffer that spans index into
+extern char *bufScanner(Scanner scan) {
+  ScannerRep r=scan;
+  return r->str;
+}
+
+// This function makes a caller-owned copy of the current token
+extern char *dupScanner(Scanner scan) {
+  int off, len;
+  if (!spanScanner(scan,&off,&len))
+    return 0;
+  char *s=strndup(bufScanner(scan)+off,len);
+  if (!s)
+    ERROR("strndup() failed");
+  return s;
+}
+
 // This function compares the current token with a string
 extern int cmpScanner(Scanner scan, char *s) {
   ScannerRep r=scan;
-  currScanner(scan);
-  if (r->eos)
+  int off, len;
+  if (!spanScanner(scan,&off,&len))
     return 0;
-  if (strcmp(s,r->curr))
+  if (strncmp(s,r->str+off,len) || s[len])
     return 0;
   return 1;
 }
@@ -103,7 +227,7 @@ extern int cmpScanner(Scanner scan, char *s) {
 extern int eatScanner(Scanner scan, char *s) {
   int r=cmpScanner(scan,s);
   if (r)
-    nextScanner(scan);
+    advScanner(scan);
   return r;
 }
 
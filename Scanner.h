@@ -1,7 +1,9 @@
 /*
  * File: scanner.h
  * Description: Header file for scanner that breaks a string 
- * into individual words (tokens) separated by whitespace.
+ * into individual tokens: words separated by whitespace, and the
+ * operators | ; & < > ( ) which need no surrounding whitespace.
+ * Operators and whitespace inside '...' or "..." are part of a word.
  * Author(s): Jim Buffenbarger
  * Date: 10/18/25 
  */
@@ -10,8 +12,27 @@
 
 typedef void *Scanner;
 
+// Types of tokens, as returned by tokScanner()
+typedef enum {
+  TOK_EOS,    // end of string
+  TOK_WORD,
+  TOK_PIPE,   // |
+  TOK_SEMI,   // ;
+  TOK_AMP,    // &
+  TOK_LT,     // <
+  TOK_GT,     // >
+  TOK_LPAREN, // (
+  TOK_RPAREN, // )
+  TOK_LBRACE, // { standing alone as a word
+  TOK_RBRACE  // } standing alone as a word
+} Token;
+
 // Create a new scanner for string
+// The string ends at a NUL or a newline
 extern Scanner newScanner(char *s);
+// Create a new scanner that reads the string in place, without a copy
+// The string must not change or go away until the scanner is freed
+extern Scanner viewScanner(char *s);
 // Free the resources of the scanner
 extern void freeScanner(Scanner scan);
 // Get the next token from the scanner
@@ -25,4 +46,17 @@ extern int eatScanner(Scanner scan, char *s);
 // Get the current position in the string
 extern int posScanner(Scanner scan);
 
+// Get the type of the current token
+extern Token tokScanner(Scanner scan);
+// Eat the current token if it has the given type
+extern int takeScanner(Scanner scan, Token tok);
+// Move to the next token without copying it
+extern int advScanner(Scanner scan);
+// Get the current token as a view (offset, length) into the scanner's buffer
+extern int spanScanner(Scanner scan, int *off, int *len);
+// Get the scanner's buffer, which the spans index into
+extern char *bufScanner(Scanner scan);
+// Get a NUL-terminated copy of the current token, owned by the caller
+extern char *dupScanner(Scanner scan);
+
 #endif
@@ -0,0 +1,285 @@
+/*
+ * File: script.c
+ * Description: Implementation of script.h
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "Script.h"
+#include "Parser.h"
+#include "Flat.h"
+#include "Interpreter.h"
+#include "error.h"
+
+// A .shc file is:
+//   struct S_head | struct S_line[lines] | flat trees, 8-byte aligned
+// Everything is an offset, so the file is used straight from mmap().
+
+#define MAGIC "SHC\n"
+#define VERSION 1
+
+// Header of a .shc file, identifying the script it was made from
+struct S_head {
+  char magic[4];
+  uint32_t version;
+  uint32_t nodesize;  // sizeof(struct F_node) of the writer
+  uint32_t lines;     // number of line records
+  uint64_t size;      // script size in bytes
+  int64_t mtime;      // script modification time
+  int64_t mtime_ns;
+  uint64_t hash;      // hash of the script text
+  uint64_t bytes;     // size of the whole .shc file
+};
+
+// A line of the script and its flat tree
+struct S_line {
+  uint64_t text; // offset of the line in the script
+  uint64_t flat; // offset of its flat tree in the .shc file
+};
+
+// This function hashes a buffer (64-bit FNV-1a)
+static uint64_t hash(char *s, long n) {
+  uint64_t h=14695981039346656037ULL;
+  for (long i=0; i<n; i++)
+    h=(h^(unsigned char)s[i])*1099511628211ULL;
+  return h;
+}
+
+// A script mapped into memory and cut into lines
+// Lines end at their newline, which the parser stops at, so they are
+// parsed in place; only a last line with no newline is copied, since
+// nothing may follow the mapping.
+struct S_text {
+  char *text;  // the mapped script
+  long size;
+  int n;       // number of lines
+  long *offs;  // their offsets in text
+  char *tail;  // NUL-terminated copy of a last line with no newline
+};
+
+// This function maps a whole script and finds its lines
+// Returns 0 if the script cannot be mapped
+static int mapScript(int fd, long size, struct S_text *s) {
+  s->size=size;
+  s->text=size ? mmap(0,size,PROT_READ,MAP_PRIVATE,fd,0) : "";
+  if (s->text==MAP_FAILED)
+    return 0;
+  s->n=0;
+  for (char *nl=s->text; (nl=memchr(nl,'\n',s->text+size-nl)); nl++)
+    s->n++;
+  s->tail=0;
+  if (size && s->text[size-1]!='\n')
+    s->n++; // last line has no newline
+  s->offs=(long *)malloc(sizeof(long)*(s->n+1));
+  if (!s->offs)
+    ERROR("malloc() failed");
+  long off=0;
+  for (int i=0; i<s->n; i++) {
+    s->offs[i]=off;
+    char *nl=memchr(s->text+off,'\n',size-off);
+    off=nl ? nl-s->text+1 : size;
+  }
+  if (size && s->text[size-1]!='\n') {
+    long off=s->offs[s->n-1];
+    s->tail=strndup(s->text+off,size-off);
+    if (!s->tail)
+      ERROR("strndup() failed");
+  }
+  return 1;
+}
+
+// This function returns line i of a script, ended by a newline or NUL
+static char *line(struct S_text *s, int i) {
+  return s->tail && i==s->n-1 ? s->tail : s->text+s->offs[i];
+}
+
+// This function unmaps a script
+static void unmapScript(struct S_text *s) {
+  if (s->size)
+    munmap(s->text,s->size);
+  free(s->offs);
+  free(s->tail);
+}
+
+// This function makes the header describing a script
+static void head(struct S_head *h, struct stat *st, char *text) {
+  memset(h,0,sizeof(*h));
+  memcpy(h->magic,MAGIC,4);
+  h->version=VERSION;
+  h->nodesize=sizeof(struct F_node);
+  h->size=st->st_size;
+  h->mtime=st->st_mtim.tv_sec;
+  h->mtime_ns=st->st_mtim.tv_nsec;
+  h->hash=hash(text,st->st_size);
+}
+
+// This function maps a .shc file, if it is sound and matches want
+// Returns the mapping, or 0 to fall back to parsing
+static char *load(char *shc, struct S_head *want, int n, long *bytes) {
+  int fd=open(shc,O_RDONLY);
+  if (fd<0)
+    return 0;
+  struct stat st;
+  char *map=0;
+  if (!fstat(fd,&st) && st.st_size>=(long)sizeof(struct S_head))
+    map=mmap(0,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+  close(fd);
+  if (!map || map==MAP_FAILED)
+    return 0;
+  struct S_head *h=(struct S_head *)map;
+  struct S_line *l=(struct S_line *)(h+1);
+  int ok=!memcmp(h->magic,want->magic,4) && h->version==want->version &&
+    h->nodesize==want->nodesize && h->size==want->size &&
+    h->mtime==want->mtime && h->mtime_ns==want->mtime_ns &&
+    h->hash==want->hash && h->lines==(uint32_t)n &&
+    h->bytes==(uint64_t)st.st_size &&
+    sizeof(*h)+n*sizeof(*l)<=(uint64_t)st.st_size;
+  for (int i=0; ok && i<n; i++)
+    ok=l[i].flat%8==0 && l[i].flat<(uint64_t)st.st_size &&
+      checkFlat(map+l[i].flat,st.st_size-l[i].flat);
+  if (!ok) {
+    munmap(map,st.st_size);
+    return 0;
+  }
+  *bytes=st.st_size;
+  return map;
+}
+
+// This function parses every line and builds the .shc image
+// Returns the image, or 0 if some line has a syntax error
+static char *compile(struct S_text *s, struct S_head *want, long *bytes) {
+  int n=s->n;
+  Parser parser=newParser();
+  Arena arena=newArena();
+  Flat *flats=(Flat *)malloc(sizeof(Flat)*(n+1));
+  if (!flats)
+    ERROR("malloc() failed");
+  long size=sizeof(struct S_head)+n*sizeof(struct S_line);
+  int i;
+  for (i=0; i<n; i++) {
+    Tree tree=parseParser(parser,line(s,i),arena);
+    if (errorParser(parser))
+      break;
+    flats[i]=flattenTree(tree);
+    resetArena(arena);
+    size+=(sizeFlat(flats[i])+7)&~7;
+  }
+  char *image=0;
+  if (i==n && (image=(char *)calloc(1,size))) {
+    struct S_head *h=(struct S_head *)image;
+    struct S_line *l=(struct S_line *)(h+1);
+    *h=*want;
+    h->lines=n;
+    h->bytes=size;
+    long off=sizeof(*h)+n*sizeof(*l);
+    for (int j=0; j<n; j++) {
+      l[j].text=s->offs[j];
+      l[j].flat=off;
+      memcpy(image+off,flats[j],sizeFlat(flats[j]));
+      off+=(sizeFlat(flats[j])+7)&~7;
+    }
+    *bytes=size;
+  }
+  while (i--)
+    freeFlat(flats[i]);
+  free(flats);
+  freeParser(parser);
+  freeArena(arena);
+  return image;
+}
+
+// This function writes the .shc image, replacing the old file at once
+// Failure only costs the next run a parse
+static void save(char *shc, char *image, long bytes) {
+  char *tmp=(char *)malloc(strlen(shc)+16);
+  if (!tmp)
+    ERROR("malloc() failed");
+  sprintf(tmp,"%s.%d",shc,(int)getpid());
+  int fd=open(tmp,O_WRONLY|O_CREAT|O_TRUNC,0666);
+  if (fd>=0) {
+    int ok=write(fd,image,bytes)==bytes;
+    ok=!close(fd) && ok;
+    if (!ok || rename(tmp,shc))
+      unlink(tmp);
+  }
+  free(tmp);
+}
+
+// This function runs lines, parsing each one as it is reached
+// (a syntax error stops the shell there, as it would on stdin)
+static void interpret(struct S_text *s, int *eof, Jobs jobs) {
+  Parser parser=newParser();
+  Arena arena=newArena();
+  for (int i=0; i<s->n && !*eof; i++) {
+    Tree tree=parseParser(parser,line(s,i),arena);
+    if (errorParser(parser)) {
+      fprintf(stderr,"%s\n",errorParser(parser));
+      exit(1);
+    }
+    Flat flat=flattenTree(tree);
+    resetArena(arena);
+    interpretFlat(flat,eof,jobs);
+    freeFlat(flat);
+  }
+  freeParser(parser);
+  freeArena(arena);
+}
+
+// This function runs a script
+// arguments:
+//   path - the script file
+//   eof - pointer to int indicating end-of-file (set by exit)
+//   jobs - the jobs collection
+extern void runScript(char *path, int *eof, Jobs jobs) {
+  int fd=open(path,O_RDONLY);
+  struct stat st;
+  if (fd<0 || fstat(fd,&st)) {
+    fprintf(stderr,"%s: cannot open script\n",path);
+    exit(1);
+  }
+  struct S_text text;
+  int ok=mapScript(fd,st.st_size,&text);
+  close(fd);
+  if (!ok) {
+    fprintf(stderr,"%s: cannot read script\n",path);
+    exit(1);
+  }
+  struct S_head want;
+  head(&want,&st,text.text);
+  int n=text.n;
+
+  // the cache is path with .shc in place of .sh, or .shc added
+  int len=strlen(path);
+  char *shc=(char *)malloc(len+5);
+  if (!shc)
+    ERROR("malloc() failed");
+  sprintf(shc,"%s%s",path,len>3 && !strcmp(path+len-3,".sh") ? "c" : ".shc");
+
+  long bytes;
+  char *map=load(shc,&want,n,&bytes);
+  char *image=map ? 0 : compile(&text,&want,&bytes);
+  if (image)
+    save(shc,image,bytes);
+  char *use=map ? map : image;
+  if (use) { // run straight from the cached trees
+    struct S_line *l=(struct S_line *)(use+sizeof(struct S_head));
+    for (int i=0; i<n && !*eof; i++)
+      interpretFlat(use+l[i].flat,eof,jobs);
+  } else // a line has a syntax error: run up to it
+    interpret(&text,eof,jobs);
+
+  if (map)
+    munmap(map,bytes);
+  free(image);
+  free(shc);
+  unmapScript(&text);
+}
@@ -0,0 +1,18 @@
+/*
+ * File: script.h
+ * Description: Header file for running script files, with a
+ * precompiled cache of their parse trees kept next to them.
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25 
+ */
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include "Jobs.h"
+
+// Run the script at path, line by line
+// The parse trees come from path's .shc cache when it matches the
+// script; otherwise the script is parsed and the cache rewritten
+extern void runScript(char *path, int *eof, Jobs jobs);
+
+#endif
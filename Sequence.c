@@ -34,3 +34,17 @@ extern void execSequence(Sequence sequence, Jobs jobs, int *eof) {
     execPipeline(deq_head_get(sequence),jobs,eof); // We execute head pipeline
   freeSequence(sequence); // free the sequence when done
 }
+
+// execute all pipelines in the sequence, as the last thing this process
+// does: the last pipeline runs in tail position (see tailPipeline())
+// parameters:
+//   sequence: the sequence of pipelines to execute
+//   jobs: the jobs to process
+//   eof: pointer to an int that indicates end-of-file
+extern void tailSequence(Sequence sequence, Jobs jobs, int *eof) {
+  while (deq_len(sequence) > 1 && !*eof) // all but the last pipeline
+    execPipeline(deq_head_get(sequence),jobs,eof);
+  if (deq_len(sequence) && !*eof)
+    tailPipeline(deq_head_get(sequence),jobs,eof);
+  freeSequence(sequence);
+}
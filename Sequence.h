@@ -21,5 +21,7 @@ extern void addSequence(Sequence sequence, Pipeline pipeline);
 extern void freeSequence(Sequence sequence);
 // execute all pipelines in the sequence on the given jobs
 extern void execSequence(Sequence sequence, Jobs jobs, int *eof);
+// execute them as the last thing this process does (see tailPipeline())
+extern void tailSequence(Sequence sequence, Jobs jobs, int *eof);
 
 #endif
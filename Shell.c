@@ -7,6 +7,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <signal.h>
 #include <termios.h>
@@ -15,60 +16,200 @@
 #include <sys/wait.h>
 #include "Jobs.h"
 #include "Parser.h"
+#include "Arena.h"
+#include "Flat.h"
+#include "Cache.h"
+#include "Ahead.h"
+#include "Script.h"
+#include "Path.h"
+#include "Reader.h"
 #include "Interpreter.h"
+#include "Command.h"
+#include "Pipeline.h"
+#include "Zygote.h"
 #include "error.h"
 
-//clean up finished background jobs
+//note that a child changed state; the jobs reap it when they next look
 void sigchld_handler(int sig) {
-  // wait for all dead processes
-  while (waitpid(-1, NULL, WNOHANG) > 0);
+  noteJobs();
 }
 
 //setup signal handlers
 void setup_signals() {
   signal(SIGTSTP, SIG_IGN);  // Shell ignores ^Z
   signal(SIGINT, SIG_IGN);   // Shell ignores ^C
-  signal(SIGCHLD, sigchld_handler);  // clean up zombies processes
+  signal(SIGCHLD, sigchld_handler);  // note children to reap
+}
+
+static Reader reader=0; // batch input, when not using readline
+
+// Read the next line without a prompt (for parse-ahead)
+static char *readLine() {
+  return readline(0);
+}
+
+// Read the next line from the batch reader (for parse-ahead)
+static char *readBatch() {
+  char *line=nextReader(reader);
+  return line ? strdup(line) : 0;
+}
+
+// Report a syntax error and exit, as the parser always has
+static void syntax(char *error) {
+  fprintf(stderr,"%s\n",error);
+  fflush(stderr);
+  exit(1);
+}
+
+// Run the lines of a -c command line, as a script would run them
+static void runLines(char *s, int *eof, Jobs jobs) {
+  Parser parser=newParser();
+  Arena arena=newArena();
+  while (s && !*eof) {
+    Tree tree=parseParser(parser,s,arena); // parses up to a newline
+    if (errorParser(parser))
+      syntax(errorParser(parser));
+    Flat flat=flattenTree(tree);
+    resetArena(arena);
+    s=strchr(s,'\n'); // on to the next line, if any
+    if (s && *++s)
+      interpretFlat(flat,eof,jobs);
+    else // the last one: its last command can replace the shell
+      tailFlat(flat,eof,jobs);
+    freeFlat(flat);
+  }
+  freeParser(parser);
+  freeArena(arena);
 }
 
 // Main shell loop
-int main() {
+// Usage: shell [-a n] [-f] [-r] [-p bytes] [-z] [-c cmdline [name [arg ...]] | script [arg ...]]
+//   -a n: when input is not a terminal, parse up to n lines ahead
+//         on a helper thread while the current line runs
+//   -f: launch commands with fork() and execvp(), as the shell used to,
+//       instead of posix_spawnp() (for comparison)
+//   -r: read input that is not a terminal with readline, as the
+//       shell used to, instead of in blocks (slower, but a command
+//       reading the shell's stdin from a pipe sees the rest of it)
+//   -p bytes: make the pipes of pipelines this big (see pipesize)
+//   -z: launch commands through a zygote, a helper process forked
+//       here, before the shell grows (see Zygote.h)
+//   -c cmdline: run cmdline instead of reading stdin; name is $0
+//   script: run the lines of this file instead of reading stdin
+//   arg: $1, $2, ... of the script or cmdline
+int main(int argc, char *argv[]) {
+  int ahead_lines=0; // lines to parse ahead, 0 for none
+  int use_readline=0; // 1 to read non-terminal input with readline
+  char *cmdline=0; // the -c command line
+  int opt;
+  int use_zygote=0; // 1 to launch commands through a zygote
+  while ((opt=getopt(argc,argv,"+a:frp:zc:"))!=-1) { // options end at script
+    if (opt=='a' && atoi(optarg)>0)
+      ahead_lines=atoi(optarg);
+    else if (opt=='f')
+      spawnCommand(0);
+    else if (opt=='r')
+      use_readline=1;
+    else if (opt=='p' && atol(optarg)>=0)
+      bufferPipeline(atol(optarg));
+    else if (opt=='z')
+      use_zygote=1;
+    else if (opt=='c')
+      cmdline=optarg;
+    else {
+      fprintf(stderr,"usage: %s [-a lines] [-f] [-r] [-p bytes] [-z] "
+              "[-c cmdline [name [arg ...]] | script [arg ...]]\n",argv[0]);
+      exit(1);
+    }
+  }
   setup_signals();  // Setup signal handlers
+  if (use_zygote) // now, while the shell is small
+    startZygote();
   int eof=0;// end-of-file flag
   Jobs jobs=newJobs();// Create jobs structure
+
+  // Command-line and script modes: no readline, no history
+  if (cmdline || optind<argc) {
+    if (optind<argc)
+      paramsCommand(argc-optind,argv+optind); // $0 is name or script
+    else
+      paramsCommand(1,argv); // $0 is the shell
+    if (cmdline)
+      runLines(cmdline,&eof,jobs);
+    else
+      runScript(argv[optind],&eof,jobs);
+    freestateCommand(); // free command state
+    freeJobs(jobs);  // Free jobs before exiting
+    freeCache(); // Free the parse cache
+    freePath(); // Free the command path table
+    stopZygote(); // Stop the zygote, if any
+    return 0;
+  }
   char *prompt=0;// prompt string
+  Parser parser=newParser();// parses each line
+  Arena arena=newArena();// holds each line's parse tree
+  Ahead ahead=0;// parse-ahead, if enabled
+  int interactive=isatty(fileno(stdin));
 
-  // Setup readline 
-  if (isatty(fileno(stdin))) {
+  // Setup input: readline for a terminal (or -r), else the batch reader
+  if (interactive) {
     using_history(); // enable history
     read_history(".history"); // read history from file
     prompt="$ "; // set prompt
-  } else { // non-interactive mode
+  } else if (use_readline) { // non-interactive mode
     rl_bind_key('\t',rl_insert); // This disable tab completion
     rl_outstream=fopen("/dev/null","w"); // disable output
-  }
+  } else // batch mode: readline is never set up, no history is kept
+    reader=newReader(fileno(stdin));
+  if (!interactive && ahead_lines) // from here on, only the helper reads
+    ahead=newAhead(ahead_lines,reader ? readBatch : readLine);
   
   // Main loop
   while (!eof) {
-    char *line=readline(prompt); // read a line
-    if (!line)
-      break;
-    if (*line) // if line is not empty
+    char *line; // the line to run
+    Flat flat; // its parse
+    if (ahead) { // already read and parsed by the helper
+      char *error;
+      if (!nextAhead(ahead,&line,&flat,&error))
+        break;
+      if (error)
+        syntax(error);
+    } else {
+      if (interactive) // report the jobs that have ended
+        reportJobs(jobs,stdout);
+      // read a line (the reader's lines are not ours to free)
+      line=reader ? nextReader(reader) : readline(prompt);
+      if (!line)
+        break;
+      flat=getCache(line,parser,arena); // parse the line, unless cached
+      if (!flat)
+        syntax(errorParser(parser));
+    }
+    if (*line && !reader) // if line is not empty
       add_history(line); // add to history
-    Tree tree=parseTree(line); // parse the line
-    free(line); // free the line
-    interpretTree(tree,&eof,jobs); // interpret the parse tree
-    freeTree(tree); // free the parse tree
+    if (ahead || !reader)
+      free(line); // free the line
+    interpretFlat(flat,&eof,jobs); // interpret the flat parse tree
+    dropCache(flat); // give back the flat parse tree
   }
 
   // Cleanup before exiting
-  if (isatty(fileno(stdin))) { // interactive mode
+  if (ahead)
+    freeAhead(ahead); // stop parsing ahead
+  if (interactive) { // interactive mode
     write_history(".history"); // write history to file
     rl_clear_history(); // clear history
+  } else if (reader) {
+    freeReader(reader); // free the batch reader
   } else {
     fclose(rl_outstream); // close disabled output
   }
   freestateCommand(); // free command state
   freeJobs(jobs);  // Free jobs before exiting
+  freeParser(parser); // Free the parser
+  freeArena(arena); // Free the parse tree memory
+  freeCache(); // Free the parse cache
+  freePath(); // Free the command path table
+  stopZygote(); // Stop the zygote, if any
   return 0;
 }
@@ -0,0 +1,13 @@
+# Lines too long to commit, made here: a million words in one
+# command, then 50,000 commands in one sequence; a parser that is
+# quadratic in either runs out of time
+words() { # $1 copies of x
+  yes x | head -n $1 | tr '\n' ' '
+}
+{
+  echo "( exit ; echo $(words 1000000) )"
+  echo "echo $(words 1000000) | wc -w"
+  echo "$(yes 'true ;' | head -n 50000 | tr '\n' ' ') echo sequence done"
+  echo "echo survived"
+} | timeout 10 ./shell
+[ $? -ne 124 ] || echo timed out
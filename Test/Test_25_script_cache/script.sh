@@ -0,0 +1,4 @@
+echo first line
+{ echo block ; echo "in (parens)" ; } | cat
+exit
+echo not reached
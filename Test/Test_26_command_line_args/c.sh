@@ -0,0 +1,5 @@
+# -c with parameters after the command line: $0 is the name
+./shell -c 'echo $0 $1 $2 $# $@' name one two
+./shell -c 'printf [%s]\n $@' name one two
+./shell -c "echo '\$1' x\$1 \"\$1\"" name one
+./shell -c 'echo $@ $* $@ / $#' name one two three
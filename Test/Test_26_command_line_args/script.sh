@@ -0,0 +1,3 @@
+echo $0 has $# args: $@
+echo first=$1 second=$2 none=$7 cost=$
+echo $*
@@ -0,0 +1,8 @@
+# 30 built-in stages whose output does not fit in its pipe, with at
+# most 20 descriptors: each pipe must be closed as its thread is done
+line=
+for i in $(seq 30); do
+  line="$line printf %0300000d\\n 1 | cat |"
+done
+ulimit -n 20
+printf '%s\n' "${line% |} | wc -c" | ./shell
@@ -0,0 +1,10 @@
+ls -d Test
+echo through the zygote | wc -w
+ls Test/Test_34_zygote/missing
+cd Test
+ls -d Test_34_zygote
+cd ..
+( ls -d Test ; echo in a subshell )
+sleep 0.1 &
+fg 6
+printf %s\n b a | sort | cat
@@ -0,0 +1 @@
+kill -TERM $$
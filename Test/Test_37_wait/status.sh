@@ -0,0 +1,11 @@
+# The exit status of wait is that of ./shell -c
+./shell -c 'false & wait %1'
+echo false: $?
+./shell -c 'sleep 2 & wait -t 0.2 %1'
+echo timeout: $?
+./shell -c 'wait %9'
+echo no job: $?
+./shell -c 'sh Test/Test_37_wait/killself.sh & wait %1'
+echo SIGTERM: $?
+./shell -c 'sh Test/Test_37_wait/killself.sh & false & wait'
+echo all: $?
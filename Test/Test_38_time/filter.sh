@@ -0,0 +1,3 @@
+# Run the script, with the numbers in its usage lines (times, sizes,
+# pids) blanked, as they change from run to run
+./shell Test/Test_38_time/script.sh 2>&1 | sed -E 's/[0-9]+(\.[0-9]+)?/N/g'
@@ -0,0 +1,7 @@
+time sleep 0.1
+time echo a b | wc -w
+sleep 0.3 &
+jobs -l
+wait
+jobs -l
+jobs
@@ -0,0 +1,3 @@
+# sleep $1 tenths of a second, and say so
+sleep 0.$1
+echo slept $1
@@ -0,0 +1,3 @@
+# Run the lines, with the sizes of the cached trees blanked, as they
+# change with the layout of the tree
+./shell < Test/Test_42_parsecache/lines 2>&1 | sed -E 's/bytes [0-9]+/bytes N/'
@@ -0,0 +1,7 @@
+# Parsing 4 lines ahead must change neither the order of the output
+# nor the directory each line runs in
+./shell -a 4 < Test/Test_43_parse_ahead/lines > /tmp/ahead.$$ 2>&1
+./shell < Test/Test_43_parse_ahead/lines > /tmp/plain.$$ 2>&1
+cat /tmp/ahead.$$
+cmp /tmp/ahead.$$ /tmp/plain.$$ && echo same as without -a
+rm /tmp/ahead.$$ /tmp/plain.$$
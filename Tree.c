@@ -13,23 +13,23 @@
 #include "error.h"
 
 #define ALLOC(t) \
-  t v=malloc(sizeof(*v)); \
+  t v=arena ? allocArena(arena,sizeof(*v)) : malloc(sizeof(*v)); \
   if (!v) ERROR("malloc() failed"); \
   return memset(v,0,sizeof(*v));
 
 // Create a new sequence and allocate memory for it
-extern T_sequence new_sequence() {ALLOC(T_sequence)}
+extern T_sequence new_sequence(Arena arena) {ALLOC(T_sequence)}
 // Create a new pipeline and allocate memory for it
-extern T_pipeline new_pipeline() {ALLOC(T_pipeline)}
+extern T_pipeline new_pipeline(Arena arena) {ALLOC(T_pipeline)}
 // Create a new command and allocate memory for it
-extern T_command  new_command()  {
-  T_command v = malloc(sizeof(*v)); 
+extern T_command  new_command(Arena arena)  {
+  T_command v = arena ? allocArena(arena,sizeof(*v)) : malloc(sizeof(*v)); 
   if (!v) ERROR("malloc() failed");
   memset(v,0,sizeof(*v)); //
   v->subshell = -1; 
   return v;
 }
 // Create a new words list and allocate memory for it
-extern T_words    new_words()    {ALLOC(T_words)}
+extern T_words    new_words(Arena arena)    {ALLOC(T_words)}
 // Create a new word and allocate memory for it
-extern T_word     new_word()     {ALLOC(T_word)}
+extern T_word     new_word(Arena arena)     {ALLOC(T_word)}
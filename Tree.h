@@ -7,6 +7,8 @@
 #ifndef TREE_H
 #define TREE_H
 
+#include "Arena.h"
+
 typedef struct T_sequence *T_sequence;
 typedef struct T_pipeline *T_pipeline;
 typedef struct T_command  *T_command;
@@ -46,15 +48,16 @@ struct T_word {
   char *s;
 };
 
+// Each constructor allocates from arena, or with malloc() if arena is 0
 // Create a new sequence
-extern T_sequence new_sequence();
+extern T_sequence new_sequence(Arena arena);
 // Create a new pipeline
-extern T_pipeline new_pipeline();
+extern T_pipeline new_pipeline(Arena arena);
 // Create a new command
-extern T_command  new_command();
+extern T_command  new_command(Arena arena);
 // Create a new words list
-extern T_words    new_words();
+extern T_words    new_words(Arena arena);
 // Create a new word
-extern T_word     new_word();
+extern T_word     new_word(Arena arena);
 
 #endif
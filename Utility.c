@@ -0,0 +1,842 @@
+/*
+ * File: utility.c
+ * Description: Implementation of utility.h
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25
+ */
+
+#define _GNU_SOURCE // for splice(), tee() and copy_file_range()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <signal.h>
+
+#include "Utility.h"
+
+// Where an escape sequence is read
+enum { ECHO, FORMAT, ARG }; // echo -e, a printf format, a printf %b argument
+
+// This function writes the character of the escape sequence at s,
+// which follows a backslash
+// An octal escape is \0nnn for echo and %b, \nnn in a format
+// (the other form is taken too, as coreutils does)
+// Returns the position after the sequence; \c sets *stop
+static char *escape(FILE *out, char *s, int where, int *stop) {
+  static const char from[]="abefnrtv\\\"";
+  static const char to[]="\a\b\33\f\n\r\t\v\\\"";
+  int c=*s;
+  if (c>='0' && c<='7') { // octal, up to 3 digits
+    int v=0, n=0;
+    if (where!=FORMAT && c=='0')
+      s++;
+    for (; n<3 && *s>='0' && *s<='7'; n++)
+      v=v*8+*s++-'0';
+    putc(v,out);
+    return s;
+  }
+  if (c=='x' && isxdigit((unsigned char)s[1])) { // hex, up to 2 digits
+    int v=0, n=0;
+    for (s++; n<2 && isxdigit((unsigned char)*s); n++, s++)
+      v=v*16+(isdigit((unsigned char)*s) ? *s-'0' : tolower(*s)-'a'+10);
+    putc(v,out);
+    return s;
+  }
+  if (c=='c') { // no more output
+    *stop=1;
+    return s+1;
+  }
+  char *p=c ? strchr(from,c) : 0;
+  if (p && !(c=='"' && where==ECHO)) {
+    putc(to[p-from],out);
+    return s+1;
+  }
+  putc('\\',out); // not an escape
+  if (c) {
+    putc(c,out);
+    s++;
+  }
+  return s;
+}
+
+// This function writes a string, reading its escape sequences
+static void escapes(FILE *out, char *s, int where, int *stop) {
+  while (*s && !*stop)
+    if (*s=='\\')
+      s=escape(out,s+1,where,stop);
+    else
+      putc(*s++,out);
+}
+
+// This function runs echo
+// Leading arguments made only of -n, -e and -E are options
+extern int echoUtility(FILE *out, char **argv) {
+  int newline=1, interpret=0;
+  for (argv++; *argv && (*argv)[0]=='-' && (*argv)[1] &&
+         strspn(*argv+1,"neE")==strlen(*argv+1); argv++)
+    for (char *o=*argv+1; *o; o++)
+      if (*o=='n')
+        newline=0;
+      else
+        interpret=*o=='e';
+  int stop=0;
+  for (int first=1; *argv && !stop; argv++, first=0) {
+    if (!first)
+      putc(' ',out);
+    if (interpret)
+      escapes(out,*argv,ECHO,&stop);
+    else
+      fputs(*argv,out);
+  }
+  if (newline && !stop)
+    putc('\n',out);
+  return 0;
+}
+
+// This function reports a printf argument that is not all a number
+static void numeric(char *arg, char *end, int *status) {
+  if (errno==ERANGE)
+    fprintf(stderr,"printf: '%s': %s\n",arg,strerror(errno));
+  else if (end==arg)
+    fprintf(stderr,"printf: '%s': expected a numeric value\n",arg);
+  else if (*end)
+    fprintf(stderr,"printf: '%s': value not completely converted\n",arg);
+  else
+    return;
+  *status=1;
+}
+
+// This function reads a printf argument as a signed integer
+// A leading quote gives the code of the character after it
+static intmax_t toint(char *arg, int *status) {
+  if (*arg=='\'' || *arg=='"')
+    return (unsigned char)arg[1];
+  char *end;
+  errno=0;
+  intmax_t v=strtoimax(arg,&end,0);
+  numeric(arg,end,status);
+  return v;
+}
+
+// This function reads a printf argument as an unsigned integer
+static uintmax_t touint(char *arg, int *status) {
+  if (*arg=='\'' || *arg=='"')
+    return (unsigned char)arg[1];
+  char *end;
+  errno=0;
+  uintmax_t v=strtoumax(arg,&end,0);
+  numeric(arg,end,status);
+  return v;
+}
+
+// This function reads a printf argument as a floating point number
+static long double toreal(char *arg, int *status) {
+  if (*arg=='\'' || *arg=='"')
+    return (unsigned char)arg[1];
+  char *end;
+  errno=0;
+  long double v=strtold(arg,&end);
+  numeric(arg,end,status);
+  return v;
+}
+
+// This function prints one conversion of a printf format, at f
+// Missing arguments are empty strings, or zero
+// Returns the position after the conversion
+static char *convert(FILE *out, char *f, char ***args, int *status,
+                     int *stop) {
+  char spec[64]; // the conversion, rebuilt for printf()
+  int n=0;
+  char *start=f++;
+  spec[n++]='%';
+  for (; *f && strchr("-+ #0'",*f); f++) // flags
+    if (n<16)
+      spec[n++]=*f;
+  for (int part=0; part<2; part++) { // width, then .precision
+    if (part) {
+      if (*f!='.')
+        break;
+      spec[n++]=*f++;
+    }
+    if (*f=='*') { // taken from an argument
+      f++;
+      n+=snprintf(spec+n,16,"%d",(int)(**args ? toint(*(*args)++,status) : 0));
+    } else
+      for (; isdigit((unsigned char)*f); f++)
+        if (n<48)
+          spec[n++]=*f;
+  }
+  while (*f && strchr("hlLqjzt",*f)) // length modifiers mean nothing here
+    f++;
+  char c=*f;
+  if (!c || !strchr("diouxXfFeEgGaAcsb",c)) {
+    fprintf(stderr,"printf: %.*s: invalid conversion specification\n",
+            (int)(f-start+(c!=0)),start);
+    *status=1;
+    *stop=1;
+    return f+(c!=0);
+  }
+  f++;
+  char *arg=**args ? *(*args)++ : 0;
+  if (strchr("di",c)) {
+    strcpy(spec+n,"jd");
+    spec[n+1]=c;
+    fprintf(out,spec,arg ? toint(arg,status) : 0);
+  } else if (strchr("ouxX",c)) {
+    strcpy(spec+n,"jd");
+    spec[n+1]=c;
+    fprintf(out,spec,arg ? touint(arg,status) : 0);
+  } else if (strchr("fFeEgGaA",c)) {
+    strcpy(spec+n,"Lf");
+    spec[n+1]=c;
+    fprintf(out,spec,arg ? toreal(arg,status) : 0.0L);
+  } else if (c=='c') {
+    strcpy(spec+n,"c");
+    fprintf(out,spec,arg ? *arg : 0);
+  } else if (c=='s') {
+    strcpy(spec+n,"s");
+    fprintf(out,spec,arg ? arg : "");
+  } else if (arg) // %b: the argument's escapes, no width
+    escapes(out,arg,ARG,stop);
+  return f;
+}
+
+// This function runs printf
+// The format is reused until every argument is consumed
+extern int printfUtility(FILE *out, char **argv) {
+  if (!argv[1]) {
+    fprintf(stderr,"printf: missing operand\n");
+    return 1;
+  }
+  char *format=argv[1];
+  char **args=argv+2;
+  char **start;
+  int status=0, stop=0;
+  do {
+    start=args;
+    for (char *f=format; *f && !stop; )
+      if (*f=='\\')
+        f=escape(out,f+1,FORMAT,&stop);
+      else if (*f!='%')
+        putc(*f++,out);
+      else if (f[1]=='%') {
+        putc('%',out);
+        f+=2;
+      } else
+        f=convert(out,f,&args,&status,&stop);
+  } while (*args && args!=start && !stop);
+  return status;
+}
+
+// The arguments of a test expression being evaluated
+struct Expr {
+  char *name; // test or [, for messages
+  char **argv;
+  int n;      // number of arguments
+  int i;      // next one
+  int error;  // 1 once an error is reported
+};
+typedef struct Expr *Test;
+
+// This function reports an error in a test expression
+static int bad(Test t, char *format, char *arg) {
+  if (!t->error) {
+    fprintf(stderr,"%s: ",t->name);
+    fprintf(stderr,format,arg);
+    fprintf(stderr,"\n");
+  }
+  t->error=1;
+  return 0;
+}
+
+// This function reads an integer operand, which may have blanks around it
+static long long integer(Test t, char *s) {
+  char *end;
+  errno=0;
+  long long v=strtoll(s,&end,10);
+  while (isblank((unsigned char)*end))
+    end++;
+  if (errno || end==s || *end || !*s)
+    bad(t,"invalid integer '%s'",s);
+  return v;
+}
+
+// This function tells whether s is a binary operator
+static int binary(char *s) {
+  static char *ops[]={"=","==","!=","-eq","-ne","-lt","-le","-gt","-ge",
+                      "-nt","-ot","-ef","-a","-o",0};
+  for (char **op=ops; *op; op++)
+    if (!strcmp(s,*op))
+      return 1;
+  return 0;
+}
+
+// This function tells whether s is a unary operator
+static int unary(char *s) {
+  return s[0]=='-' && s[1] && !s[2] && strchr("bcdefgGhLknNOprsStuwxz",s[1]);
+}
+
+// This function evaluates a binary operator
+static int dyadic(Test t, char *a, char *op, char *b) {
+  if (!strcmp(op,"=") || !strcmp(op,"=="))
+    return !strcmp(a,b);
+  if (!strcmp(op,"!="))
+    return strcmp(a,b)!=0;
+  if (!strcmp(op,"-a"))
+    return *a && *b;
+  if (!strcmp(op,"-o"))
+    return *a || *b;
+  if (op[1]=='e' && op[2]=='q') {
+    long long x=integer(t,a), y=integer(t,b);
+    return x==y;
+  }
+  if (op[1]=='n' && op[2]=='e') {
+    long long x=integer(t,a), y=integer(t,b);
+    return x!=y;
+  }
+  if (op[1]=='l' || op[1]=='g') { // -lt -le -gt -ge
+    long long x=integer(t,a), y=integer(t,b);
+    if (op[1]=='g') {
+      long long z=x; x=y; y=z;
+    }
+    return op[2]=='t' ? x<y : x<=y;
+  }
+  struct stat sa, sb;
+  int ha=!stat(a,&sa), hb=!stat(b,&sb);
+  if (!strcmp(op,"-ef"))
+    return ha && hb && sa.st_dev==sb.st_dev && sa.st_ino==sb.st_ino;
+  if (!strcmp(op,"-nt")) // a missing file is older than any
+    return ha && (!hb || sa.st_mtim.tv_sec>sb.st_mtim.tv_sec ||
+                  (sa.st_mtim.tv_sec==sb.st_mtim.tv_sec &&
+                   sa.st_mtim.tv_nsec>sb.st_mtim.tv_nsec));
+  return hb && (!ha || sa.st_mtim.tv_sec<sb.st_mtim.tv_sec || // -ot
+                (sa.st_mtim.tv_sec==sb.st_mtim.tv_sec &&
+                 sa.st_mtim.tv_nsec<sb.st_mtim.tv_nsec));
+}
+
+// This function evaluates a unary operator
+static int monadic(Test t, char *op, char *a) {
+  struct stat st;
+  switch (op[1]) {
+  case 'n': return *a!=0;
+  case 'z': return *a==0;
+  case 't': return isatty(integer(t,a));
+  case 'r': return !access(a,R_OK);
+  case 'w': return !access(a,W_OK);
+  case 'x': return !access(a,X_OK);
+  case 'h': case 'L': return !lstat(a,&st) && S_ISLNK(st.st_mode);
+  }
+  if (stat(a,&st))
+    return 0;
+  switch (op[1]) {
+  case 'b': return S_ISBLK(st.st_mode);
+  case 'c': return S_ISCHR(st.st_mode);
+  case 'd': return S_ISDIR(st.st_mode);
+  case 'f': return S_ISREG(st.st_mode);
+  case 'p': return S_ISFIFO(st.st_mode);
+  case 'S': return S_ISSOCK(st.st_mode);
+  case 'g': return (st.st_mode&S_ISGID)!=0;
+  case 'u': return (st.st_mode&S_ISUID)!=0;
+  case 'k': return (st.st_mode&S_ISVTX)!=0;
+  case 'G': return st.st_gid==getegid();
+  case 'O': return st.st_uid==geteuid();
+  case 's': return st.st_size>0;
+  case 'N': return st.st_mtim.tv_sec>st.st_atim.tv_sec ||
+      (st.st_mtim.tv_sec==st.st_atim.tv_sec &&
+       st.st_mtim.tv_nsec>st.st_atim.tv_nsec);
+  }
+  return 1; // -e
+}
+
+static int or(Test t);
+
+// This function evaluates a primary: ! primary, ( expression ),
+// a binary or unary operation, or a string
+static int primary(Test t) {
+  if (t->i>=t->n)
+    return bad(t,"missing argument after '%s'",t->argv[t->n-1]);
+  char *a=t->argv[t->i];
+  if (!strcmp(a,"!")) {
+    t->i++;
+    return !primary(t);
+  }
+  if (!strcmp(a,"(")) {
+    t->i++;
+    int v=or(t);
+    if (t->i>=t->n || strcmp(t->argv[t->i],")"))
+      return bad(t,"'%s' expected",")");
+    t->i++;
+    return v;
+  }
+  if (t->i+2<t->n && binary(t->argv[t->i+1]) &&
+      strcmp(t->argv[t->i+1],"-a") && strcmp(t->argv[t->i+1],"-o")) {
+    t->i+=3;
+    return dyadic(t,a,t->argv[t->i-2],t->argv[t->i-1]);
+  }
+  if (a[0]=='-' && a[1] && !a[2]) {
+    if (!unary(a))
+      return bad(t,"'%s': unary operator expected",a);
+    if (t->i+1>=t->n)
+      return bad(t,"missing argument after '%s'",a);
+    t->i+=2;
+    return monadic(t,a,t->argv[t->i-1]);
+  }
+  t->i++;
+  return *a!=0;
+}
+
+// This function evaluates primaries joined by -a
+static int and(Test t) {
+  int v=primary(t);
+  while (t->i<t->n && !strcmp(t->argv[t->i],"-a")) {
+    t->i++;
+    v=primary(t) && v;
+  }
+  return v;
+}
+
+// This function evaluates an expression: and's joined by -o
+static int or(Test t) {
+  int v=and(t);
+  while (t->i<t->n && !strcmp(t->argv[t->i],"-o")) {
+    t->i++;
+    v=and(t) || v;
+  }
+  return v;
+}
+
+// This function evaluates n arguments by POSIX's rules for n<=4,
+// and the general grammar beyond
+static int posix(Test t, int n) {
+  char **a=t->argv+t->i;
+  switch (n) {
+  case 0:
+    return 0;
+  case 1:
+    t->i++;
+    return *a[0]!=0;
+  case 2:
+    if (!strcmp(a[0],"!")) {
+      t->i+=2;
+      return !*a[1];
+    }
+    if (!(a[0][0]=='-' && a[0][1] && !a[0][2]))
+      return bad(t,"missing argument after '%s'",a[1]);
+    if (!unary(a[0]))
+      return bad(t,"'%s': unary operator expected",a[0]);
+    t->i+=2;
+    return monadic(t,a[0],a[1]);
+  case 3:
+    if (binary(a[1])) {
+      t->i+=3;
+      return dyadic(t,a[0],a[1],a[2]);
+    }
+    if (!strcmp(a[0],"!")) {
+      t->i++;
+      return !posix(t,2);
+    }
+    if (!strcmp(a[0],"(") && !strcmp(a[2],")")) {
+      t->i+=3;
+      return *a[1]!=0;
+    }
+    return bad(t,"'%s': binary operator expected",a[1]);
+  case 4:
+    if (!strcmp(a[0],"!")) {
+      t->i++;
+      return !posix(t,3);
+    }
+    if (!strcmp(a[0],"(") && !strcmp(a[3],")")) {
+      t->i++;
+      int v=posix(t,2);
+      t->i++;
+      return v;
+    }
+  }
+  return or(t);
+}
+
+// This function runs test, or [
+// Returns 0 if the expression is true, 1 if false, 2 on an error
+extern int testUtility(char **argv) {
+  struct Expr rep;
+  Test t=&rep;
+  t->name=argv[0];
+  t->argv=argv+1;
+  t->n=0;
+  while (t->argv[t->n])
+    t->n++;
+  t->i=0;
+  t->error=0;
+  if (!strcmp(argv[0],"[")) {
+    if (!t->n || strcmp(t->argv[t->n-1],"]")) {
+      fprintf(stderr,"[: missing ']'\n");
+      return 2;
+    }
+    t->n--;
+  }
+  int v=posix(t,t->n);
+  if (!t->error && t->i<t->n)
+    bad(t,"extra argument '%s'",t->argv[t->i]);
+  return t->error ? 2 : !v;
+}
+
+// cat and tee move data with the kernel's copying system calls, which
+// never bring it into this process: copy_file_range() from file to file,
+// splice() when either end is a pipe, tee() to duplicate a pipe, and
+// sendfile() from a file to anything else; where the one that fits is
+// not supported, they read() and write() through a large buffer
+
+#define CHUNK (1<<30) // bytes asked of one system call
+#define BUFSZ (128<<10) // bytes of the read() and write() buffer
+
+// This function tells whether a system call failed only because it
+// does not support these descriptors (or this kernel)
+static int unsupported(int err) {
+  return err==EINVAL || err==ENOSYS || err==EXDEV || err==EOPNOTSUPP ||
+         err==EBADF || err==ESPIPE;
+}
+
+// This function writes n bytes of buf to fd, or to out if fd is -1
+// Returns 0, or the errno of a failure
+static int put(int fd, FILE *out, char *buf, size_t n) {
+  if (fd==-1)
+    return fwrite(buf,1,n,out)==n ? 0 : errno;
+  while (n) {
+    ssize_t w=write(fd,buf,n);
+    if (w<0 && errno==EINTR)
+      continue;
+    if (w<0)
+      return errno;
+    buf+=w;
+    n-=w;
+  }
+  return 0;
+}
+
+// This function moves bytes from in to fd (or to out, if fd is -1):
+// *left of them, or all of in if left is 0
+// It tries the system calls that fit the descriptors, then read()
+// and write(); each picks up where the one before stopped
+// Returns 0, or the errno of a failure (*fromin is 1 if reading failed),
+// with *left counting what was not moved
+static int pump(int in, int fd, FILE *out, size_t *left, int *fromin) {
+  size_t all=SIZE_MAX;
+  if (!left)
+    left=&all;
+  struct stat si, so;
+  int reg=0, fifo=0;
+  if (fstat(in,&si)==0) {
+    reg=S_ISREG(si.st_mode);
+    fifo=S_ISFIFO(si.st_mode);
+  }
+  if (fd!=-1 && fstat(fd,&so)==0) {
+    int oreg=S_ISREG(so.st_mode), ofifo=S_ISFIFO(so.st_mode);
+    for (int how=0; how<3 && *left; how++) {
+      if ((how==0 && !(reg && oreg)) || (how==1 && !(fifo || ofifo)) ||
+          (how==2 && !reg))
+        continue;
+      ssize_t n;
+      do {
+        size_t len=*left<CHUNK ? *left : CHUNK;
+        n= how==0 ? copy_file_range(in,0,fd,0,len,0) :
+           how==1 ? splice(in,0,fd,0,len,SPLICE_F_MOVE) :
+                    sendfile(fd,in,0,len);
+        if (n>0 && left!=&all)
+          *left-=n;
+      } while ((n>0 && *left) || (n<0 && errno==EINTR));
+      if (n>=0) // done, or in has ended
+        return 0;
+      if (!unsupported(errno))
+        return *fromin=0, errno;
+    }
+  }
+  static __thread char *buf=0; // (kept for the next time)
+  if (!buf && !(buf=malloc(BUFSZ)))
+    return *fromin=1, ENOMEM;
+  while (*left) {
+    ssize_t n=read(in,buf,*left<BUFSZ ? *left : BUFSZ);
+    if (n<0 && errno==EINTR)
+      continue;
+    if (n<0)
+      return *fromin=1, errno;
+    if (n==0)
+      break;
+    int err=put(fd,out,buf,n);
+    if (err)
+      return *fromin=0, err;
+    if (left!=&all)
+      *left-=n;
+  }
+  return 0;
+}
+
+// This function skips the options of cat or tee, which are the
+// arguments up to the first that is not -x... (or that is --)
+// Returns the rest, with the option letters, concatenated, in opts
+static char **options(char **argv, char *opts, size_t size) {
+  size_t n=0;
+  for (argv++; *argv && **argv=='-' && (*argv)[1]; argv++) {
+    if (!strcmp(*argv,"--"))
+      return argv+1;
+    for (char *o=*argv+1; *o && n+1<size; o++)
+      opts[n++]=*o;
+  }
+  opts[n]=0;
+  return argv;
+}
+
+// This function runs cat [-u] [file ...]
+// Returns 0, or 1 if a file could not be read or out written
+extern int catUtility(FILE *out, char **argv) {
+  char opts[64];
+  char **files=options(argv,opts,sizeof(opts)); // -u: it never buffers
+  char *none[]={"-",0};
+  if (!*files)
+    files=none;
+  fflush(out);
+  int fd=fileno(out); // -1 if out is in memory
+  int status=0;
+  for (; *files; files++) {
+    int in=strcmp(*files,"-") ? open(*files,O_RDONLY|O_CLOEXEC) : 0;
+    if (in<0) {
+      fprintf(stderr,"cat: %s: %s\n",*files,strerror(errno));
+      status=1;
+      continue;
+    }
+    int fromin=0;
+    int err=pump(in,fd,out,0,&fromin);
+    if (in)
+      close(in);
+    if (err) {
+      fprintf(stderr,"cat: %s: %s\n",fromin ? *files : "write error",
+              strerror(err));
+      status=1;
+      if (!fromin)
+        break;
+    }
+  }
+  fflush(out);
+  return status;
+}
+
+// An output of tee
+typedef struct {
+  char *name;
+  int fd;      // -1 for out, when it is in memory
+  int own;     // 1 if tee opened fd
+  int pipe[2]; // its own pipe, if tee() goes through one to it
+  size_t done; // bytes of the round it has
+  int failed;
+} Output;
+
+// This function reports a failure to write an output of tee
+static void failed(Output *o, int err) {
+  if (!o->failed)
+    fprintf(stderr,"tee: %s: %s\n",o->name,strerror(err));
+  o->failed=1;
+}
+
+// This function closes the outputs that failed, and drops them
+// Returns how many are left
+static int prune(Output *os, int k) {
+  int n=0;
+  for (int j=0; j<k; j++) {
+    Output *o=&os[j];
+    if (!o->failed) {
+      os[n++]=*o;
+      continue;
+    }
+    if (o->own)
+      close(o->fd);
+    if (o->pipe[0]!=-1) {
+      close(o->pipe[0]);
+      close(o->pipe[1]);
+    }
+  }
+  return n;
+}
+
+// This function runs a round of tee from a pipe to k>1 outputs: what
+// the input holds is tee()d into every output but the last (through a
+// pipe of its own, if the output is not one), then splice()d into the
+// last, which takes it out of the input; an output tee() did not fill
+// gets the rest from *buf (of *size bytes, grown to fit), which the
+// input is read into instead
+// Returns the bytes of the round, 0 when the input has ended, or -1 if
+// tee() does not work here (nothing has been taken out of the input)
+static ssize_t fanout(Output *os, int k, char **buf, size_t *size) {
+  ssize_t m=0;
+  int whole=1; // 1 if every output has all m bytes
+  for (int j=0; j<k-1; j++) {
+    Output *o=&os[j];
+    int to=o->pipe[1]!=-1 ? o->pipe[1] : o->fd;
+    ssize_t t;
+    do
+      t=tee(0,to,j ? (size_t)m : CHUNK,0);
+    while (t<0 && errno==EINTR);
+    if (!j) {
+      if (t<=0)
+        return t<0 && unsupported(errno) ? -1 : 0;
+      m=t;
+    }
+    if (t<0)
+      failed(o,errno);
+    o->done=t<0 ? 0 : t;
+    whole&=o->done==(size_t)m;
+    if (o->pipe[0]!=-1) { // on into the output
+      size_t left=o->done;
+      int fromin, err=pump(o->pipe[0],o->fd,0,&left,&fromin);
+      if (err) {
+        failed(o,err);
+        while (left && (t=read(o->pipe[0],*buf,left<*size ? left : *size))>0)
+          left-=t; // (empty it for the next round)
+      }
+    }
+  }
+  Output *last=&os[k-1];
+  if (whole) {
+    size_t left=m;
+    int fromin, err=pump(0,last->fd,0,&left,&fromin);
+    if (!err)
+      return m;
+    if (fromin)
+      return 0; // (the input has gone)
+    failed(last,err);
+    while (left) { // take the rest out of the input
+      ssize_t n=read(0,*buf,left<*size ? left : *size);
+      if (n<=0)
+        return 0;
+      left-=n;
+    }
+    return m;
+  }
+  // Some output needs bytes tee() did not give it: read them all
+  if ((size_t)m>*size) {
+    char *more=realloc(*buf,m);
+    if (!more) {
+      for (int j=0; j<k; j++)
+        failed(&os[j],ENOMEM);
+      return 0;
+    }
+    *buf=more;
+    *size=m;
+  }
+  ssize_t n=0;
+  while (n<m) {
+    ssize_t r=read(0,*buf+n,m-n);
+    if (r<0 && errno==EINTR)
+      continue;
+    if (r<=0)
+      break;
+    n+=r;
+  }
+  last->done=0;
+  for (int j=0; j<k; j++)
+    if (!os[j].failed && os[j].done<(size_t)n) {
+      int err=put(os[j].fd,0,*buf+os[j].done,n-os[j].done);
+      if (err)
+        failed(&os[j],err);
+    }
+  return n;
+}
+
+// This function runs tee [-ai] [file ...]: standard input goes to out
+// and to each file
+// Returns 0, or 1 if a file could not be opened or written
+extern int teeUtility(FILE *out, char **argv) {
+  char opts[64];
+  char **files=options(argv,opts,sizeof(opts));
+  if (strchr(opts,'i'))
+    signal(SIGINT,SIG_IGN);
+  int flags=O_WRONLY|O_CREAT|O_CLOEXEC|(strchr(opts,'a') ? O_APPEND : O_TRUNC);
+  int n=0;
+  while (files[n])
+    n++;
+  Output *os=malloc(sizeof(Output)*(n+1)); // out, then the files
+  size_t size=BUFSZ;
+  char *buf=malloc(size);
+  if (!os || !buf) {
+    free(os);
+    free(buf);
+    fprintf(stderr,"tee: %s\n",strerror(ENOMEM));
+    return 1;
+  }
+  fflush(out);
+  int status=0, k=0;
+  os[k++]=(Output){"standard output",fileno(out),0,{-1,-1},0,0};
+  for (int i=0; i<n; i++) {
+    int fd=open(files[i],flags,0666);
+    if (fd<0) {
+      fprintf(stderr,"tee: %s: %s\n",files[i],strerror(errno));
+      status=1;
+    } else
+      os[k++]=(Output){files[i],fd,1,{-1,-1},0,0};
+  }
+
+  // From a pipe to descriptors, the data need not come in here
+  struct stat st;
+  int splicing=os[0].fd!=-1 && fstat(0,&st)==0 && S_ISFIFO(st.st_mode);
+  for (int j=0; splicing && j<k-1; j++)
+    if (!(fstat(os[j].fd,&st)==0 && S_ISFIFO(st.st_mode))) {
+      if (pipe2(os[j].pipe,O_CLOEXEC)) {
+        splicing=0;
+        break;
+      }
+      // as big as the input, so one tee() can take all it holds
+      int size=fcntl(0,F_GETPIPE_SZ);
+      if (size>0)
+        fcntl(os[j].pipe[1],F_SETPIPE_SZ,size);
+    }
+  int ended=0;
+  while (splicing && !ended && k>1) {
+    ssize_t m=fanout(os,k,&buf,&size);
+    if (m<0)
+      splicing=0; // on with the buffer
+    ended=!m;
+    for (int j=0; j<k; j++)
+      status|=os[j].failed;
+    k=prune(os,k);
+  }
+  if (splicing && !ended && k==1) { // just the one: as cat does it
+    int fromin, err=pump(0,os[0].fd,0,0,&fromin);
+    if (err)
+      failed(&os[0],err);
+    ended=1;
+  }
+
+  // Otherwise, through the buffer
+  while (!ended && k) {
+    ssize_t m=read(0,buf,BUFSZ);
+    if (m<0 && errno==EINTR)
+      continue;
+    if (m<0) {
+      fprintf(stderr,"tee: standard input: %s\n",strerror(errno));
+      status=1;
+    }
+    if (m<=0)
+      break;
+    for (int j=0; j<k; j++) {
+      int err=put(os[j].fd,out,buf,m);
+      if (err)
+        failed(&os[j],err);
+      status|=os[j].failed;
+    }
+    k=prune(os,k);
+  }
+  fflush(out);
+  for (int j=0; j<k; j++) {
+    status|=os[j].failed;
+    os[j].failed=1; // (so prune() closes it)
+  }
+  prune(os,k);
+  free(os);
+  free(buf);
+  return status;
+}
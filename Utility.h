@@ -0,0 +1,27 @@
+/*
+ * File: utility.h
+ * Description: Header file for utilities the shell runs in process:
+ * echo, printf, test, cat and tee, behaving as the coreutils programs do.
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25 
+ */
+#ifndef UTILITY_H
+#define UTILITY_H
+
+#include <stdio.h>
+
+// Each takes the argv of the command, writes to out (and stderr),
+// and returns the exit status the program would have
+
+// echo [-neE] [string ...]
+extern int echoUtility(FILE *out, char **argv);
+// printf format [argument ...]
+extern int printfUtility(FILE *out, char **argv);
+// test expression, or [ expression ] when argv[0] is "["
+extern int testUtility(char **argv);
+// cat [-u] [file ...], copying in the kernel where it can
+extern int catUtility(FILE *out, char **argv);
+// tee [-ai] [file ...], likewise
+extern int teeUtility(FILE *out, char **argv);
+
+#endif
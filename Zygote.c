@@ -0,0 +1,284 @@
+/*
+ * File: zygote.c
+ * Description: Implementation of zygote.h
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25
+ */
+
+#define _GNU_SOURCE // for pipe2(), MSG_CMSG_CLOEXEC and CLONE_PARENT
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "Zygote.h"
+#include "error.h"
+
+// The shell and the zygote talk over a Unix socketpair: a request is a
+// Request, which carries the command's four descriptors (standard
+// input, output, error and working directory) with SCM_RIGHTS, then
+// its file and argv strings; the answer is a Reply
+// The zygote forks with CLONE_PARENT, so the command is the shell's
+// child: the shell waits for it, and job control works on it, as if
+// it had forked it itself, but only the zygote's few pages are copied
+
+typedef struct {
+  pid_t pgid; // process group: 0 for its own, -1 to leave it
+  int argc;
+  size_t len; // bytes of the strings that follow
+} Request;
+
+typedef struct {
+  pid_t pid;
+  int err; // errno of the failure, 0 if it runs
+} Reply;
+
+#define NFDS 4 // descriptors sent with a request
+
+static int sock=-1; // the shell's end of the socketpair
+static pid_t zygote=0; // the zygote's pid
+static pid_t owner=0; // the shell that started it (not a subshell)
+
+// This function writes all n bytes of buf to fd
+// Returns 0, or -1 on a failure
+static int writeall(int fd, void *buf, size_t n) {
+  char *p=buf;
+  while (n) {
+    ssize_t w=write(fd,p,n);
+    if (w<0 && errno==EINTR)
+      continue;
+    if (w<=0)
+      return -1;
+    p+=w;
+    n-=w;
+  }
+  return 0;
+}
+
+// This function sends all n bytes of buf on socket fd; a reader that
+// is gone is EPIPE, not SIGPIPE
+// Returns 0, or -1 on a failure
+static int sendall(int fd, void *buf, size_t n) {
+  char *p=buf;
+  while (n) {
+    ssize_t w=send(fd,p,n,MSG_NOSIGNAL);
+    if (w<0 && errno==EINTR)
+      continue;
+    if (w<=0)
+      return -1;
+    p+=w;
+    n-=w;
+  }
+  return 0;
+}
+
+// This function reads all n bytes of buf from fd
+// Returns 0, or -1 on a failure or end of file
+static int readall(int fd, void *buf, size_t n) {
+  char *p=buf;
+  while (n) {
+    ssize_t r=read(fd,p,n);
+    if (r<0 && errno==EINTR)
+      continue;
+    if (r<=0)
+      return -1;
+    p+=r;
+    n-=r;
+  }
+  return 0;
+}
+
+// This function runs in the process cloned for a command: it puts the
+// descriptors, process group, signals and directory in place and
+// execs the file; if it cannot, it writes errno to err
+static void child(Request *q, int fds[NFDS], char *file, char **argv,
+                  int err) {
+  if (q->pgid != -1)
+    setpgid(0,q->pgid); // its own group, or the pipeline's
+  signal(SIGTSTP, SIG_DFL); // Restore default handler for SIGTSTP
+  signal(SIGINT, SIG_DFL); // Restore default handler for SIGINT
+  sigset_t none;
+  sigemptyset(&none);
+  sigprocmask(SIG_SETMASK,&none,0);
+  for (int i=0; i<3; i++) // (the received ones are close-on-exec)
+    dup2(fds[i],i);
+  if (fchdir(fds[3])==0)
+    execv(file,argv);
+  int e=errno;
+  writeall(err,&e,sizeof(e));
+  _exit(127);
+}
+
+// This function is the zygote: it launches commands until the shell
+// closes its end of the socket; never returns
+static void serve() {
+  signal(SIGCHLD, SIG_DFL); // its commands are the shell's children
+  int null=open("/dev/null",O_RDWR); // it holds none of the shell's pipes
+  if (null>=0) {
+    dup2(null,0);
+    dup2(null,1);
+    if (null>1)
+      close(null);
+  }
+  char *buf=0;
+  size_t size=0;
+  char **argv=0;
+  int nargv=0;
+  for (;;) {
+    Request q;
+    int fds[NFDS];
+    char control[CMSG_SPACE(sizeof(fds))];
+    struct iovec iov={&q,sizeof(q)};
+    struct msghdr m={0};
+    m.msg_iov=&iov;
+    m.msg_iovlen=1;
+    m.msg_control=control;
+    m.msg_controllen=sizeof(control);
+    ssize_t n=recvmsg(sock,&m,MSG_WAITALL|MSG_CMSG_CLOEXEC);
+    if (n<0 && errno==EINTR)
+      continue;
+    struct cmsghdr *c=CMSG_FIRSTHDR(&m);
+    if (n!=sizeof(q) || !c || c->cmsg_type!=SCM_RIGHTS ||
+        c->cmsg_len!=CMSG_LEN(sizeof(fds)))
+      _exit(0); // the shell is gone
+    memcpy(fds,CMSG_DATA(c),sizeof(fds));
+    if (q.len>size) {
+      free(buf);
+      if (!(buf=malloc(size=q.len)))
+        _exit(1);
+    }
+    if (q.argc+1>nargv) {
+      free(argv);
+      if (!(argv=malloc(sizeof(char *)*(nargv=q.argc+1))))
+        _exit(1);
+    }
+    if (readall(sock,buf,q.len))
+      _exit(0);
+    char *file=buf, *s=buf+strlen(buf)+1;
+    for (int i=0; i<q.argc; i++, s+=strlen(s)+1)
+      argv[i]=s;
+    argv[q.argc]=0;
+
+    // Clone the command; a close-on-exec pipe says if its exec failed
+    Reply a={-1,0};
+    int err[2];
+    if (pipe2(err,O_CLOEXEC))
+      a.err=errno;
+    else {
+      pid_t pid=syscall(SYS_clone,CLONE_PARENT|SIGCHLD,0,0,0,0);
+      if (pid==0)
+        child(&q,fds,file,argv,err[1]);
+      if (pid<0)
+        a.err=errno;
+      close(err[1]);
+      int e;
+      if (pid>0 && readall(err[0],&e,sizeof(e)))
+        a.pid=pid; // it runs
+      else if (pid>0)
+        a.err=e;
+      close(err[0]);
+    }
+    for (int i=0; i<NFDS; i++)
+      close(fds[i]);
+    if (sendall(sock,&a,sizeof(a)))
+      _exit(0);
+  }
+}
+
+// This function forks the zygote, while the shell is still small
+// Returns 1 if it is running
+extern int startZygote() {
+  int sv[2];
+  if (socketpair(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0,sv)) {
+    WARN("socketpair() failed: no zygote");
+    return 0;
+  }
+  pid_t pid=fork();
+  if (pid==-1) {
+    WARN("fork() failed: no zygote");
+    close(sv[0]);
+    close(sv[1]);
+    return 0;
+  }
+  if (pid==0) {
+    close(sv[0]);
+    sock=sv[1];
+    serve();
+  }
+  close(sv[1]);
+  sock=sv[0];
+  zygote=pid;
+  owner=getpid();
+  return 1;
+}
+
+// This function sends a launch request to the zygote and waits for
+// the answer
+extern int launchZygote(pid_t *pid, char *file, char **argv,
+                        int fds[3], pid_t pgid) {
+  if (sock==-1 || getpid()!=owner)
+    return -1; // (a subshell could not wait for what it launched)
+  int cwd=open(".",O_PATH|O_DIRECTORY|O_CLOEXEC);
+  if (cwd<0)
+    return errno;
+  Request q={pgid,0,strlen(file)+1};
+  for (char **a=argv; *a; a++, q.argc++)
+    q.len+=strlen(*a)+1;
+  char *buf=malloc(q.len);
+  if (!buf) {
+    close(cwd);
+    return ENOMEM;
+  }
+  char *s=stpcpy(buf,file)+1;
+  for (char **a=argv; *a; a++)
+    s=stpcpy(s,*a)+1;
+
+  int all[NFDS]={fds[0],fds[1],fds[2],cwd};
+  char control[CMSG_SPACE(sizeof(all))];
+  memset(control,0,sizeof(control));
+  struct iovec iov={&q,sizeof(q)};
+  struct msghdr m={0};
+  m.msg_iov=&iov;
+  m.msg_iovlen=1;
+  m.msg_control=control;
+  m.msg_controllen=sizeof(control);
+  struct cmsghdr *c=CMSG_FIRSTHDR(&m);
+  c->cmsg_level=SOL_SOCKET;
+  c->cmsg_type=SCM_RIGHTS;
+  c->cmsg_len=CMSG_LEN(sizeof(all));
+  memcpy(CMSG_DATA(c),all,sizeof(all));
+  ssize_t n;
+  do
+    n=sendmsg(sock,&m,MSG_NOSIGNAL);
+  while (n<0 && errno==EINTR);
+  Reply a;
+  int ok=n==sizeof(q) && !sendall(sock,buf,q.len) &&
+         !readall(sock,&a,sizeof(a));
+  free(buf);
+  close(cwd);
+  if (!ok) { // it has gone: on without it
+    WARN("the zygote has gone");
+    stopZygote();
+    return -1;
+  }
+  if (a.err)
+    return a.err;
+  *pid=a.pid;
+  return 0;
+}
+
+// This function stops the zygote: it exits when its end of the socket
+// sees end of file
+extern void stopZygote() {
+  if (sock==-1 || getpid()!=owner)
+    return;
+  close(sock);
+  sock=-1;
+  waitpid(zygote,0,0); // (unless SIGCHLD's handler has reaped it)
+}
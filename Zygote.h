@@ -0,0 +1,27 @@
+/*
+ * File: zygote.h
+ * Description: Header file for the zygote, a small helper process
+ * forked when the shell starts, which launches external commands
+ * for it from its own small address space.
+ * Author(s): Miguel Carrasco
+ * Date: 10/18/25
+ */
+#ifndef ZYGOTE_H
+#define ZYGOTE_H
+
+#include <sys/types.h>
+
+// Fork the zygote; returns 1 if it is running
+extern int startZygote();
+// Launch file with argv through the zygote, as posix_spawn() would:
+// fds are its standard input, output and error, and pgid is the
+// process group to put it in (0 for its own, -1 to leave it)
+// The process is the shell's child, so it is waited for as any other
+// Returns 0 with *pid set, the errno of the failure, or -1 if there is
+// no zygote (for this process) to launch it
+extern int launchZygote(pid_t *pid, char *file, char **argv,
+                        int fds[3], pid_t pgid);
+// Stop the zygote
+extern void stopZygote();
+
+#endif